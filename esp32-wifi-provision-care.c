@@ -3,6 +3,7 @@
     Public domain
 */
 #include <inttypes.h>
+#include <strings.h>
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -14,15 +15,98 @@
 #include "esp_mac.h"
 #include "nvs_flash.h"
 #include "esp_http_server.h"
+#include "esp_http_client.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/constant_time.h"
+#ifdef CONFIG_WIFI_PROVISION_CARE_MAINTENANCE
+#include "mdns.h"
+#endif
 #include "dns_server.h"
 #include "lwip/inet.h"
 #include "nvs.h"
 #include "cJSON.h"
+#include "esp32-wifi-provision-care.h"
+
+#define NVS_NAMESPACE "wifiprovcare"
 
 static const char *TAG = "esp32-wifi-provision-care";
 static esp_netif_t *s_wifi_sta_netif = NULL;
 static SemaphoreHandle_t s_semph_get_ip_addrs = NULL;
 char   s_ap_ssid_name_copy[32];
+static SemaphoreHandle_t s_semph_ota_verify = NULL;
+static wifi_provision_care_health_check_t s_health_check = NULL;
+
+// MARK: NVS config
+// Write values only if differ from stored. Caller commits once all settings set and *dirty is true.
+static inline esp_err_t nvs_set_u8_if_changed(nvs_handle_t nvs, const char *key, uint8_t value, bool *dirty)
+{
+    uint8_t stored;
+    if (nvs_get_u8(nvs, key, &stored) == ESP_OK && stored == value)
+    {
+        return ESP_OK;
+    }
+    *dirty = true;
+    return nvs_set_u8(nvs, key, value);
+}
+
+static inline esp_err_t nvs_set_u32_if_changed(nvs_handle_t nvs, const char *key, uint32_t value, bool *dirty)
+{
+    uint32_t stored;
+    if (nvs_get_u32(nvs, key, &stored) == ESP_OK && stored == value)
+    {
+        return ESP_OK;
+    }
+    *dirty = true;
+    return nvs_set_u32(nvs, key, value);
+}
+
+// Erase single NVS namespace in default partition.
+static esp_err_t nvs_erase_namespace(const char *namespace_name)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(namespace_name, NVS_READWRITE, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK; // Nothing stored yet
+    }
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_erase_all(nvs);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+// MARK: delayed restart
+static void esp_restart_after_3sec_task( void *param )
+{
+    vTaskDelay( 3000 / portTICK_PERIOD_MS );
+    esp_restart();
+    vTaskDelete(NULL); // Task functions should never return.
+}
+// Dealyed restart. Give some time to httpd server.
+static void esp_restart_after_3sec(void)
+{
+    xTaskCreate(esp_restart_after_3sec_task, "delayed_restart_3s", 4096, NULL, tskIDLE_PRIORITY, NULL);
+}
+
+static void esp_restart_after_10min_task( void *param )
+{
+    vTaskDelay( 10*60*1000 / portTICK_PERIOD_MS );
+    esp_restart();
+    vTaskDelete(NULL); // Task functions should never return.
+}
+// Dealyed restart. Try to reconnect with stored credentials.
+static void esp_restart_after_10min(void)
+{
+    xTaskCreate(esp_restart_after_10min_task, "delayed_restart_10m", 4096, NULL, tskIDLE_PRIORITY, NULL);
+}
 
 // MARK: httpd handlers
 // HTTP /favicon.ico
@@ -69,15 +153,32 @@ static esp_err_t root_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-// HTTP /nvserase - Perform NVS erase
+// Reset Wi-Fi and component settings, then restart. Erase takes hundreds of ms, keep it off httpd task.
+static void nvserase_task(void *param)
+{
+    esp_err_t err = esp_wifi_restore();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to restore Wi-Fi settings (%s).", esp_err_to_name(err));
+    }
+    err = nvs_erase_namespace(NVS_NAMESPACE);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to erase NVS namespace '%s' (%s).", NVS_NAMESPACE, esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "NVS settings reset finished.");
+    esp_restart_after_3sec();
+    vTaskDelete(NULL); // Task functions should never return.
+}
+
+// HTTP /nvserase - Perform NVS settings reset
 static esp_err_t nvserase_get_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "Perform NVS full erase.");
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_LOGI(TAG, "Perform NVS settings reset.");
+    xTaskCreate(nvserase_task, "nvserase", 4096, NULL, tskIDLE_PRIORITY, NULL);
     httpd_resp_set_type(req, "text/html");
     httpd_resp_set_hdr(req, "Connection", "close");
-    httpd_resp_send(req, "Perform NVS full erase.", HTTPD_RESP_USE_STRLEN);
+    httpd_resp_send(req, "Perform NVS settings reset.", HTTPD_RESP_USE_STRLEN);
     return ESP_OK;
 }
 
@@ -106,7 +207,14 @@ static esp_err_t savewifi_get_handler(httpd_req_t *req)
             if ( strlen((char *)wifi_cfg.sta.ssid) > 0 && strlen((char *)wifi_cfg.sta.password) > 0 )
             {
                 httpd_resp_set_type(req, "text/html");
-                if (esp_wifi_set_storage(WIFI_STORAGE_FLASH) == ESP_OK &&
+                wifi_config_t stored_cfg = { 0 };
+                if (esp_wifi_get_config(WIFI_IF_STA, &stored_cfg) == ESP_OK &&
+                        strncmp((char *)stored_cfg.sta.ssid, (char *)wifi_cfg.sta.ssid, sizeof(wifi_cfg.sta.ssid)) == 0 &&
+                        strncmp((char *)stored_cfg.sta.password, (char *)wifi_cfg.sta.password, sizeof(wifi_cfg.sta.password)) == 0)
+                {
+                    ESP_LOGI(TAG, "Wi-Fi settings unchanged, skip flash write.");
+                    httpd_resp_send(req, "Wi-Fi settings saved.", HTTPD_RESP_USE_STRLEN);
+                } else if (esp_wifi_set_storage(WIFI_STORAGE_FLASH) == ESP_OK &&
                         esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg) == ESP_OK)
                 {
                     ESP_LOGI(TAG, "Wi-Fi settings saved, SSID: '%s', password: '%s'.", (char *)wifi_cfg.sta.ssid, (char *)wifi_cfg.sta.password );
@@ -116,7 +224,7 @@ static esp_err_t savewifi_get_handler(httpd_req_t *req)
                     httpd_resp_send(req, "Failed to write Wi-Fi config to flash.", HTTPD_RESP_USE_STRLEN);
                 }
                 free(buf);
-                esp_restart();
+                esp_restart_after_3sec(); // Give some time to httpd server
                 return ESP_OK;
             }
         }
@@ -136,9 +244,17 @@ static esp_err_t scanap_get_handler(httpd_req_t *req)
     wifi_ap_record_t ap_info[15];
     uint16_t ap_count = 0;
     memset(ap_info, 0, sizeof(ap_info));
-    ESP_ERROR_CHECK(esp_wifi_scan_start(NULL, true));
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&number, ap_info));
+    esp_err_t err = esp_wifi_scan_start(NULL, true);
+    if (err == ESP_OK)
+    {
+        esp_wifi_scan_get_ap_num(&ap_count);
+        err = esp_wifi_scan_get_ap_records(&number, ap_info);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Wi-Fi scan failed (%s).", esp_err_to_name(err));
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Wi-Fi scan failed.");
+    }
     ESP_LOGI(TAG, "Total APs scanned = %u, actual AP number ap_info holds = %u", ap_count, number);
 
     httpd_resp_set_type(req, "application/json");
@@ -161,70 +277,242 @@ static esp_err_t scanap_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static void esp_restart_after_3sec_task( void *param )
+// MARK: ota rollback
+void wifi_provision_care_set_health_check(wifi_provision_care_health_check_t health_check)
 {
-    vTaskDelay( 3000 / portTICK_PERIOD_MS );
-    esp_restart();
-    vTaskDelete(NULL); // Task functions should never return.
+    s_health_check = health_check;
 }
-// Dealyed restart. Give some time to httpd server.
-static void esp_restart_after_3sec(void)
+
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+// Boot state of running firmware. Tests replace it with simulated store.
+typedef struct {
+    bool      (*pending_verify)(void);
+    esp_err_t (*mark_valid)(void);
+    esp_err_t (*mark_invalid_and_reboot)(void); // Does not return on success
+    void      (*record)(wifi_provision_care_ota_result_t result, uint32_t verify_ms);
+} ota_boot_state_t;
+
+static bool ota_pending_verify(void)
 {
-    xTaskCreate(esp_restart_after_3sec_task, "delayed_restart_3s", 4096, NULL, tskIDLE_PRIORITY, NULL);
+    esp_ota_img_states_t ota_state;
+    return esp_ota_get_state_partition(esp_ota_get_running_partition(), &ota_state) == ESP_OK &&
+           ota_state == ESP_OTA_IMG_PENDING_VERIFY;
 }
 
-static void esp_restart_after_10min_task( void *param )
+// Store new firmware verification outcome. Old firmware can read it after rollback.
+static void ota_verify_record(wifi_provision_care_ota_result_t result, uint32_t verify_ms)
 {
-    vTaskDelay( 10*60*1000 / portTICK_PERIOD_MS );
-    esp_restart();
-    vTaskDelete(NULL); // Task functions should never return.
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to open NVS namespace '%s' (%s).", NVS_NAMESPACE, esp_err_to_name(err));
+        return;
+    }
+    bool dirty = false;
+    err = nvs_set_u8_if_changed(nvs, "ota_result", result, &dirty);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_u32_if_changed(nvs, "ota_verify_ms", verify_ms, &dirty);
+    }
+    if (err == ESP_OK && dirty)
+    {
+        err = nvs_commit(nvs); // One commit for all settings
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to store firmware verification result (%s).", esp_err_to_name(err));
+    }
+    nvs_close(nvs);
 }
-// Dealyed restart. Try to reconnect with stored credentials.
-static void esp_restart_after_10min(void)
+
+static const ota_boot_state_t s_esp_ota_boot_state = {
+    .pending_verify = ota_pending_verify,
+    .mark_valid = esp_ota_mark_app_valid_cancel_rollback,
+    .mark_invalid_and_reboot = esp_ota_mark_app_invalid_rollback_and_reboot,
+    .record = ota_verify_record,
+};
+static const ota_boot_state_t *s_ota_boot_state = &s_esp_ota_boot_state;
+
+#define OTA_VERIFY_POLL_MS       1000 // Health check period, application may need time to start after Wi-Fi connected
+#define OTA_MARK_VALID_RETRIES   3
+
+// Poll health check until it passes or remaining_ms runs out.
+static wifi_provision_care_ota_result_t ota_verify_decide(bool wifi_connected, wifi_provision_care_health_check_t health_check,
+        uint32_t remaining_ms)
 {
-    xTaskCreate(esp_restart_after_10min_task, "delayed_restart_10m", 4096, NULL, tskIDLE_PRIORITY, NULL);
+    if (!wifi_connected)
+    {
+        return WIFI_PROVISION_CARE_OTA_NO_WIFI;
+    }
+    if (health_check == NULL)
+    {
+        return WIFI_PROVISION_CARE_OTA_VALID;
+    }
+    while (!health_check())
+    {
+        if (remaining_ms < OTA_VERIFY_POLL_MS)
+        {
+            return WIFI_PROVISION_CARE_OTA_CHECK_FAILED;
+        }
+        vTaskDelay(pdMS_TO_TICKS(OTA_VERIFY_POLL_MS));
+        remaining_ms -= OTA_VERIFY_POLL_MS;
+    }
+    return WIFI_PROVISION_CARE_OTA_VALID;
 }
 
-// MARK: ota handler
-// todo CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE handling
-// HTTP /updateota - Wi-Fi page
-#define BUFSIZE 5800 // 5760 - receive chunk, got from httpd server logs
-esp_err_t wifi_provision_care_updateota_post_handler(httpd_req_t *req)
+// Confirm new firmware or roll back. Outcome is recorded before reboot, rollback never returns on success.
+// Returns recorded outcome.
+static wifi_provision_care_ota_result_t ota_verify_finish(const ota_boot_state_t *boot_state,
+        wifi_provision_care_ota_result_t result, uint32_t verify_ms)
 {
-    esp_err_t err;
-    /* update handle : set by esp_ota_begin(), must be freed via esp_ota_end() */
-    esp_ota_handle_t update_handle = 0 ;
+    if (result == WIFI_PROVISION_CARE_OTA_VALID)
+    {
+        ESP_LOGI(TAG, "New firmware verified in %"PRIu32" ms. Cancel rollback.", verify_ms);
+        esp_err_t err = ESP_FAIL;
+        for (int attempt = 0; attempt < OTA_MARK_VALID_RETRIES && err != ESP_OK; attempt++)
+        {
+            if ((err = boot_state->mark_valid()) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to mark new firmware valid (%s).", esp_err_to_name(err));
+                vTaskDelay(100 / portTICK_PERIOD_MS);
+            }
+        }
+        // Image still pending verify, bootloader rolls it back on next reset
+        result = (err == ESP_OK) ? result : WIFI_PROVISION_CARE_OTA_MARK_VALID_FAILED;
+        boot_state->record(result, verify_ms);
+        return result;
+    }
+    boot_state->record(result, verify_ms);
+    ESP_LOGE(TAG, "Mark new firmware invalid. Rollback to previous firmware.");
+    esp_err_t err = boot_state->mark_invalid_and_reboot();
+    if (err == ESP_OK)
+    {
+        return result; // Restart in progress
+    }
+    ESP_LOGE(TAG, "Rollback failed (%s). Keep running new firmware.", esp_err_to_name(err));
+    boot_state->record(WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED, verify_ms);
+    return WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED;
+}
 
-    ESP_LOGI(TAG, "Starting update over the air.");
+// Wait for Wi-Fi connection and application health check, then confirm new firmware or roll back.
+static void ota_verify_task(void *param)
+{
+    const uint32_t timeout_ms = CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT * 1000;
+    const TickType_t start = xTaskGetTickCount();
+    const bool connected = xSemaphoreTake(s_semph_ota_verify, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+    const uint32_t elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    wifi_provision_care_ota_result_t result = ota_verify_decide(connected, s_health_check,
+                                              (elapsed_ms < timeout_ms) ? timeout_ms - elapsed_ms : 0);
+    if (result == WIFI_PROVISION_CARE_OTA_NO_WIFI)
+    {
+        ESP_LOGE(TAG, "New firmware failed to connect to Wi-Fi in %d seconds.", CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT);
+    } else if (result == WIFI_PROVISION_CARE_OTA_CHECK_FAILED) {
+        ESP_LOGE(TAG, "New firmware failed application health check in %d seconds.", CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT);
+    }
+    ota_verify_finish(s_ota_boot_state, result, pdTICKS_TO_MS(xTaskGetTickCount() - start));
+    vTaskDelete(NULL); // Task functions should never return.
+}
 
+// Start new firmware verification if running image is pending verify after update over the air.
+static void ota_verify_start(void)
+{
+    if (!s_ota_boot_state->pending_verify())
+    {
+        return;
+    }
+    ESP_LOGI(TAG, "New firmware pending verify. Deadline %d seconds.", CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT);
+    // Never deleted, IP event handler may give it at any time
+    s_semph_ota_verify = xSemaphoreCreateBinary();
+    assert(s_semph_ota_verify != NULL);
+    xTaskCreate(ota_verify_task, "ota_verify", 4096, NULL, (tskIDLE_PRIORITY + 1), NULL);
+}
+#endif // CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+
+// MARK: ota helpers
+// Shared by push and pull update. Check partitions and begin writing image to next update partition.
+static esp_err_t ota_begin(size_t image_size, const esp_partition_t **partition, esp_ota_handle_t *handle)
+{
     const esp_partition_t *configured = esp_ota_get_boot_partition();
     const esp_partition_t *running = esp_ota_get_running_partition();
-    if (configured != running)
+    if (configured != NULL && running != NULL && configured != running)
     {
         ESP_LOGW(TAG, "Configured OTA boot partition at offset 0x%08"PRIx32", but running from offset 0x%08"PRIx32,
                  configured->address, running->address);
         ESP_LOGW(TAG, "(This can happen if either the OTA boot data or preferred boot image become corrupted somehow.)");
     }
 
-    if ( req->content_len == 0 )
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL)
     {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware too short.");
-        return ESP_OK;
+        ESP_LOGE(TAG, "No OTA update partition, check partition table.");
+        return ESP_ERR_NOT_FOUND;
     }
-    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
-    if ( req->content_len > update_partition->size )
+    if (image_size > update_partition->size)
     {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware too big.");
-        return ESP_OK;
+        ESP_LOGE(TAG, "Firmware too big, %zu bytes, partition '%s' %"PRIu32" bytes.", image_size,
+                 update_partition->label, update_partition->size);
+        return ESP_ERR_INVALID_SIZE;
     }
-    ESP_LOGI(TAG, "Begin writing %d bytes firmware to partition '%s'.", req->content_len,  update_partition->label);
+    ESP_LOGI(TAG, "Begin writing %zu bytes firmware to partition '%s'.", image_size, update_partition->label);
 
-    err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &update_handle);
+    *handle = 0;
+    esp_err_t err = esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, handle);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(err));
-        esp_ota_abort(update_handle);
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "esp_ota_begin failed.");
+        esp_ota_abort(*handle);
+        return err;
+    }
+    *partition = update_partition;
+    return ESP_OK;
+}
+
+// Validate written image and set it to boot
+static esp_err_t ota_finish(esp_ota_handle_t handle, const esp_partition_t *partition)
+{
+    esp_err_t err = esp_ota_end(handle);
+    if (err != ESP_OK)
+    {
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED)
+        {
+            ESP_LOGE(TAG, "Image validation failed, image is corrupted!");
+        } else {
+            ESP_LOGE(TAG, "esp_ota_end failed (%s)!", esp_err_to_name(err));
+        }
+        return err;
+    }
+    err = esp_ota_set_boot_partition(partition);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed (%s)!", esp_err_to_name(err));
+        return err;
+    }
+    return ESP_OK;
+}
+
+// MARK: ota handler
+// HTTP /updateota - Wi-Fi page
+#define BUFSIZE 5800 // 5760 - receive chunk, got from httpd server logs
+esp_err_t wifi_provision_care_updateota_post_handler(httpd_req_t *req)
+{
+    esp_err_t err;
+    /* update handle : set by esp_ota_begin(), must be freed via esp_ota_end() */
+    esp_ota_handle_t update_handle = 0 ;
+    const esp_partition_t *update_partition = NULL;
+
+    ESP_LOGI(TAG, "Starting update over the air.");
+
+    if ( req->content_len == 0 )
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Firmware too short.");
+        return ESP_OK;
+    }
+    err = ota_begin(req->content_len, &update_partition, &update_handle);
+    if (err != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                            (err == ESP_ERR_INVALID_SIZE) ? "Firmware too big." : "esp_ota_begin failed.");
         return ESP_OK;
     }
 
@@ -260,33 +548,464 @@ esp_err_t wifi_provision_care_updateota_post_handler(httpd_req_t *req)
     }
     free(buf);
 
-    err = esp_ota_end(update_handle);
+    err = ota_finish(update_handle, update_partition);
     if (err != ESP_OK)
     {
-        if (err == ESP_ERR_OTA_VALIDATE_FAILED)
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                            (err == ESP_ERR_OTA_VALIDATE_FAILED) ? "Firmware image corrupted." : "Failed to finish update.");
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Restart to new firmware.");
+    httpd_resp_set_type(req, "text/html");
+    httpd_resp_send(req, "Update firmware over the air finished sucessfully.", HTTPD_RESP_USE_STRLEN);
+    esp_restart_after_3sec(); // Give some time to httpd server
+    return ESP_OK;
+}
+
+// MARK: pull ota
+// Download firmware from HTTP server with range requests. Each fetcher task owns one buffer,
+// so PULLOTA_FETCHERS ranges are in flight while the previous range is written to flash.
+#define PULLOTA_RANGE_SIZE (16 * 1024)
+#define PULLOTA_FETCHERS   2
+#define PULLOTA_RETRIES    5
+
+struct pullota_ctx;
+typedef struct {
+    struct pullota_ctx *ctx;
+    int                 first_range;
+    char               *buf;
+    int                 len;     // range length
+    esp_err_t           err;     // range download result
+    SemaphoreHandle_t   filled;  // fetcher -> writer, buf holds range
+    SemaphoreHandle_t   free;    // writer -> fetcher, buf can be reused
+} pullota_slot_t;
+
+typedef struct pullota_ctx {
+    const char       *url;
+    int               image_size;
+    int               range_count;
+    volatile bool     abort;
+    SemaphoreHandle_t exited;    // counting, given by each fetcher on exit
+    pullota_slot_t    slot[PULLOTA_FETCHERS];
+} pullota_ctx_t;
+
+// Download bytes [offset, offset+len) into buf. On failure resume from last received byte.
+// Keep-alive connection is kept open between ranges and closed only after an error.
+static esp_err_t pullota_fetch_range(esp_http_client_handle_t client, int offset, int len, char *buf)
+{
+    int received = 0;
+    for (int attempt = 0; attempt < PULLOTA_RETRIES && received < len; attempt++)
+    {
+        if (attempt > 0)
         {
-            ESP_LOGE(TAG, "Image validation failed, image is corrupted!");
-        } else {
-            ESP_LOGE(TAG, "esp_ota_end failed (%s)!", esp_err_to_name(err));
+            ESP_LOGW(TAG, "Range at offset %d interrupted, resume from %d bytes.", offset, received);
+            esp_http_client_close(client);
+            vTaskDelay(1000 / portTICK_PERIOD_MS);
         }
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "esp_ota_end failed.");
-        return ESP_OK;
+        char range[48];
+        snprintf(range, sizeof(range), "bytes=%d-%d", offset + received, offset + len - 1);
+        esp_http_client_set_header(client, "Range", range);
+        if (esp_http_client_open(client, 0) != ESP_OK)
+        {
+            continue;
+        }
+        if (esp_http_client_fetch_headers(client) < 0)
+        {
+            continue;
+        }
+        const int status = esp_http_client_get_status_code(client);
+        if (status == 200)
+        {
+            ESP_LOGE(TAG, "Server does not support range requests.");
+            esp_http_client_close(client);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (status != 206)
+        {
+            ESP_LOGW(TAG, "Range at offset %d got HTTP %d.", offset, status); // e.g. 503 busy, retry
+            continue;
+        }
+        if (esp_http_client_get_content_length(client) != len - received)
+        {
+            // Other range than requested, do not write it to flash, leftover body breaks keep-alive connection
+            ESP_LOGW(TAG, "Range at offset %d got %"PRId64" bytes, requested %d.", offset,
+                     esp_http_client_get_content_length(client), len - received);
+            continue;
+        }
+        int r;
+        while (received < len && (r = esp_http_client_read(client, buf + received, len - received)) > 0)
+        {
+            received += r;
+        }
+    }
+    if (received != len)
+    {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void pullota_fetch_task(void *param)
+{
+    pullota_slot_t *slot = (pullota_slot_t *)param;
+    pullota_ctx_t  *ctx = slot->ctx;
+
+    esp_http_client_config_t config = { .url = ctx->url, .timeout_ms = 10000, .keep_alive_enable = true };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    for (int range = slot->first_range; range < ctx->range_count; range += PULLOTA_FETCHERS)
+    {
+        xSemaphoreTake(slot->free, portMAX_DELAY);
+        if (ctx->abort)
+        {
+            break;
+        }
+        const int offset = range * PULLOTA_RANGE_SIZE;
+        slot->len = (ctx->image_size - offset > PULLOTA_RANGE_SIZE) ? PULLOTA_RANGE_SIZE : ctx->image_size - offset;
+        slot->err = (client != NULL) ? pullota_fetch_range(client, offset, slot->len, slot->buf) : ESP_ERR_NO_MEM;
+        xSemaphoreGive(slot->filled);
+        if (slot->err != ESP_OK)
+        {
+            break;
+        }
+    }
+    if (client != NULL)
+    {
+        esp_http_client_cleanup(client);
     }
-    err = esp_ota_set_boot_partition(update_partition);
+    xSemaphoreGive(ctx->exited);
+    vTaskDelete(NULL); // Task functions should never return.
+}
+
+// HEAD request to get firmware size
+static int pullota_get_image_size(const char *url)
+{
+    esp_http_client_config_t config = { .url = url, .timeout_ms = 10000, .method = HTTP_METHOD_HEAD };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL)
+    {
+        return -1;
+    }
+    int64_t size = -1;
+    if (esp_http_client_perform(client) == ESP_OK && esp_http_client_get_status_code(client) == 200)
+    {
+        size = esp_http_client_get_content_length(client);
+    }
+    esp_http_client_cleanup(client);
+    return (int)size;
+}
+
+esp_err_t wifi_provision_care_pull_ota(const char *url, const char *sha256_hex)
+{
+    esp_err_t err = ESP_OK;
+    esp_ota_handle_t update_handle = 0;
+    const esp_partition_t *update_partition = NULL;
+
+    if (url == NULL || sha256_hex == NULL || strlen(sha256_hex) != 64)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_LOGI(TAG, "Starting pull update over the air from %s", url);
+
+    const int image_size = pullota_get_image_size(url);
+    if (image_size <= 0)
+    {
+        ESP_LOGE(TAG, "Failed to get firmware size.");
+        return ESP_FAIL;
+    }
+    err = ota_begin(image_size, &update_partition, &update_handle);
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "esp_ota_set_boot_partition failed (%s)!", esp_err_to_name(err));
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "esp_ota_set_boot_partition failed.");
-        return ESP_OK;
+        return err;
+    }
+
+    pullota_ctx_t *ctx = calloc(1, sizeof(pullota_ctx_t));
+    assert(ctx != NULL);
+    ctx->url = url;
+    ctx->image_size = image_size;
+    ctx->range_count = (image_size + PULLOTA_RANGE_SIZE - 1) / PULLOTA_RANGE_SIZE;
+    ctx->exited = xSemaphoreCreateCounting(PULLOTA_FETCHERS, 0);
+    assert(ctx->exited != NULL);
+
+    for (int i = 0; i < PULLOTA_FETCHERS; i++)
+    {
+        pullota_slot_t *slot = &ctx->slot[i];
+        slot->ctx = ctx;
+        slot->first_range = i;
+        slot->buf = malloc(PULLOTA_RANGE_SIZE);
+        slot->filled = xSemaphoreCreateBinary();
+        slot->free = xSemaphoreCreateBinary();
+        assert(slot->buf != NULL && slot->filled != NULL && slot->free != NULL);
+        xSemaphoreGive(slot->free);
+    }
+    int started = 0;
+    for (int i = 0; i < PULLOTA_FETCHERS; i++)
+    {
+        if (xTaskCreate(pullota_fetch_task, "pullota_fetch", 6144, &ctx->slot[i], (tskIDLE_PRIORITY + 5), NULL) != pdPASS)
+        {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        started++;
+    }
+
+    mbedtls_sha256_context sha256;
+    mbedtls_sha256_init(&sha256);
+    mbedtls_sha256_starts(&sha256, 0);
+    const TickType_t start = xTaskGetTickCount();
+    for (int range = 0; range < ctx->range_count && err == ESP_OK; range++)
+    {
+        pullota_slot_t *slot = &ctx->slot[range % PULLOTA_FETCHERS];
+        xSemaphoreTake(slot->filled, portMAX_DELAY);
+        if (slot->err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Firmware download failed at offset %d.", range * PULLOTA_RANGE_SIZE);
+            err = slot->err;
+            break;
+        }
+        err = esp_ota_write(update_handle, (const void *)slot->buf, slot->len);
+        mbedtls_sha256_update(&sha256, (const unsigned char *)slot->buf, slot->len);
+        xSemaphoreGive(slot->free);
+    }
+    const uint32_t elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+
+    // Stop fetchers waiting for a free buffer and wait for all of them to exit
+    ctx->abort = true;
+    for (int i = 0; i < PULLOTA_FETCHERS; i++)
+    {
+        xSemaphoreGive(ctx->slot[i].free);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        xSemaphoreTake(ctx->exited, portMAX_DELAY);
+    }
+    for (int i = 0; i < PULLOTA_FETCHERS; i++)
+    {
+        free(ctx->slot[i].buf);
+        vSemaphoreDelete(ctx->slot[i].filled);
+        vSemaphoreDelete(ctx->slot[i].free);
+    }
+    vSemaphoreDelete(ctx->exited);
+    free(ctx);
+
+    unsigned char digest[32];
+    mbedtls_sha256_finish(&sha256, digest);
+    mbedtls_sha256_free(&sha256);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Pull update over the air failed (%s).", esp_err_to_name(err));
+        esp_ota_abort(update_handle);
+        return err;
+    }
+    ESP_LOGI(TAG, "Firmware downloaded in %"PRIu32" ms, %"PRIu32" KiB/s.", elapsed_ms,
+             (uint32_t)((uint64_t)image_size * 1000 / 1024 / (elapsed_ms > 0 ? elapsed_ms : 1)));
+
+    char digest_hex[65];
+    for (int i = 0; i < sizeof(digest); i++)
+    {
+        sprintf(&digest_hex[i * 2], "%02x", digest[i]);
+    }
+    if (strcasecmp(digest_hex, sha256_hex) != 0)
+    {
+        ESP_LOGE(TAG, "Firmware SHA-256 mismatch, got %s.", digest_hex);
+        esp_ota_abort(update_handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    err = ota_finish(update_handle, update_partition);
+    if (err != ESP_OK)
+    {
+        return err;
     }
 
     ESP_LOGI(TAG, "Restart to new firmware.");
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, "Update firmware over the air finished sucessfully.", HTTPD_RESP_USE_STRLEN);
-    esp_restart_after_3sec(); // Give some time to httpd server
+    esp_restart_after_3sec();
     return ESP_OK;
 }
 
+// MARK: maintenance portal
+// Provisioning portal on application http server in STA mode.
+#ifdef CONFIG_WIFI_PROVISION_CARE_MAINTENANCE
+static char *s_maintenance_auth = NULL; // Expected "Authorization" header value
+static SemaphoreHandle_t s_semph_maintenance_idle = NULL; // Single async request or scan in flight
+
+static bool maintenance_authorized(httpd_req_t *req)
+{
+    size_t len = httpd_req_get_hdr_value_len(req, "Authorization");
+    if (len == 0 || len != strlen(s_maintenance_auth))
+    {
+        return false;
+    }
+    char *auth = malloc(len + 1);
+    if (auth == NULL)
+    {
+        return false;
+    }
+    // Constant time compare, response time does not reveal matching prefix
+    bool ok = httpd_req_get_hdr_value_str(req, "Authorization", auth, len + 1) == ESP_OK &&
+              mbedtls_ct_memcmp(auth, s_maintenance_auth, len) == 0;
+    free(auth);
+    return ok;
+}
+
+static esp_err_t maintenance_unauthorized(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "401 Unauthorized");
+    httpd_resp_set_hdr(req, "WWW-Authenticate", "Basic realm=\"esp32-wifi-provision-care\"");
+    httpd_resp_set_hdr(req, "Connection", "close");
+    httpd_resp_send(req, "Unauthorized.", HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Request sent by fetch() of portal page. Browser sends custom header cross-origin only after CORS preflight,
+// which portal does not answer, so <img src="http://esp32.local/nvserase"> on other site is refused.
+static bool maintenance_from_portal(httpd_req_t *req)
+{
+    char value[sizeof("XMLHttpRequest")];
+    return httpd_req_get_hdr_value_str(req, "X-Requested-With", value, sizeof(value)) == ESP_OK &&
+           strcmp(value, "XMLHttpRequest") == 0;
+}
+
+// Check credentials, then call portal handler passed in user_ctx.
+static esp_err_t maintenance_auth_handler(httpd_req_t *req)
+{
+    if (!maintenance_authorized(req))
+    {
+        return maintenance_unauthorized(req);
+    }
+    esp_err_t (*handler)(httpd_req_t *req) = req->user_ctx;
+    return handler(req);
+}
+
+// Check credentials and portal origin, then call state changing portal handler passed in user_ctx.
+static esp_err_t maintenance_action_handler(httpd_req_t *req)
+{
+    if (!maintenance_authorized(req))
+    {
+        return maintenance_unauthorized(req);
+    }
+    if (!maintenance_from_portal(req))
+    {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "X-Requested-With header required.");
+    }
+    esp_err_t (*handler)(httpd_req_t *req) = req->user_ctx;
+    return handler(req);
+}
+
+static void maintenance_async_task(void *param)
+{
+    httpd_req_t *req = (httpd_req_t *)param;
+    esp_err_t (*handler)(httpd_req_t *req) = req->user_ctx;
+    handler(req);
+    httpd_req_async_handler_complete(req);
+    xSemaphoreGive(s_semph_maintenance_idle);
+    vTaskDelete(NULL); // Task functions should never return.
+}
+
+// Check credentials and portal origin, then call blocking portal handler on low priority task. httpd task
+// stays free. One request at a time, Wi-Fi driver runs single scan and each task holds a request socket.
+static esp_err_t maintenance_async_handler(httpd_req_t *req)
+{
+    if (!maintenance_authorized(req))
+    {
+        return maintenance_unauthorized(req);
+    }
+    if (!maintenance_from_portal(req))
+    {
+        return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "X-Requested-With header required.");
+    }
+    if (xSemaphoreTake(s_semph_maintenance_idle, 0) != pdTRUE)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, "Busy, try again.", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    httpd_req_t *async_req = NULL;
+    esp_err_t err = httpd_req_async_handler_begin(req, &async_req);
+    if (err != ESP_OK)
+    {
+        xSemaphoreGive(s_semph_maintenance_idle);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start request.");
+    }
+    if (xTaskCreate(maintenance_async_task, "maintenance_req", 4096, async_req, (tskIDLE_PRIORITY + 1), NULL) != pdPASS)
+    {
+        httpd_resp_send_err(async_req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start request.");
+        httpd_req_async_handler_complete(async_req);
+        xSemaphoreGive(s_semph_maintenance_idle);
+    }
+    return ESP_OK;
+}
+
+esp_err_t wifi_provision_care_maintenance_start(httpd_handle_t server, uint16_t server_port)
+{
+    const char *user = CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_USER;
+    const char *password = CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_PASSWORD;
+    if (server == NULL || strlen(password) == 0)
+    {
+        ESP_LOGE(TAG, "Maintenance portal disabled. Set CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_PASSWORD.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (s_maintenance_auth == NULL)
+    {
+        // "Basic " + base64("user:password")
+        char credentials[strlen(user) + strlen(password) + 2];
+        sprintf(credentials, "%s:%s", user, password);
+        size_t b64_len = 0;
+        mbedtls_base64_encode(NULL, 0, &b64_len, (const unsigned char *)credentials, strlen(credentials));
+        s_maintenance_auth = malloc(strlen("Basic ") + b64_len);
+        assert(s_maintenance_auth != NULL);
+        strcpy(s_maintenance_auth, "Basic ");
+        mbedtls_base64_encode((unsigned char *)s_maintenance_auth + strlen("Basic "), b64_len, &b64_len,
+                              (const unsigned char *)credentials, strlen(credentials));
+    }
+    if (s_semph_maintenance_idle == NULL)
+    {
+        s_semph_maintenance_idle = xSemaphoreCreateBinary();
+        assert(s_semph_maintenance_idle != NULL);
+        xSemaphoreGive(s_semph_maintenance_idle);
+    }
+
+    const httpd_uri_t portal_uris[] = {
+        { .uri = "/favicon.ico", .method = HTTP_GET, .handler = maintenance_auth_handler,   .user_ctx = favicon_get_handler },
+        { .uri = "/wifi",        .method = HTTP_GET, .handler = maintenance_auth_handler,   .user_ctx = root_get_handler },
+        { .uri = "/scanap",      .method = HTTP_GET, .handler = maintenance_async_handler,  .user_ctx = scanap_get_handler },
+        { .uri = "/savewifi",    .method = HTTP_GET, .handler = maintenance_async_handler,  .user_ctx = savewifi_get_handler },
+        { .uri = "/nvserase",    .method = HTTP_GET, .handler = maintenance_action_handler, .user_ctx = nvserase_get_handler },
+    };
+    for (int i = 0; i < sizeof(portal_uris) / sizeof(portal_uris[0]); i++)
+    {
+        esp_err_t err = httpd_register_uri_handler(server, &portal_uris[i]);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to register maintenance uri %s (%s). Increase max_uri_handlers.", portal_uris[i].uri, esp_err_to_name(err));
+            while (--i >= 0) // Leave application server as it was, so start can be retried
+            {
+                httpd_unregister_uri_handler(server, portal_uris[i].uri, portal_uris[i].method);
+            }
+            return err;
+        }
+    }
+
+    mdns_txt_item_t txt[] = { { "path", "/wifi" } };
+    esp_err_t err = mdns_service_add("Wi-Fi provisioning", "_http", "_tcp", server_port, txt, sizeof(txt) / sizeof(txt[0]));
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to advertise mDNS service (%s). Is mdns_init() called?", esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "Maintenance portal started on port %u, uri /wifi.", server_port);
+    return ESP_OK;
+}
+#else
+esp_err_t wifi_provision_care_maintenance_start(httpd_handle_t server, uint16_t server_port)
+{
+    ESP_LOGE(TAG, "Maintenance portal disabled. Set CONFIG_WIFI_PROVISION_CARE_MAINTENANCE.");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif // CONFIG_WIFI_PROVISION_CARE_MAINTENANCE
+
 // MARK: httpd start
 static httpd_handle_t start_webserver(void)
 {
@@ -421,6 +1140,10 @@ static void sta_ip_event_handler(void* arg, esp_event_base_t event_base, int32_t
         ip_event_got_ip_t* event = (ip_event_got_ip_t*)event_data;
         ESP_LOGI(TAG, "Got IPv4 address: " IPSTR, IP2STR(&event->ip_info.ip));
         xSemaphoreGive(s_semph_get_ip_addrs);
+        if (s_semph_ota_verify != NULL)
+        {
+            xSemaphoreGive(s_semph_ota_verify);
+        }
         break;
 
     case IP_EVENT_GOT_IP6:
@@ -455,6 +1178,10 @@ void wifi_provision_care(char *ap_ssid_name)
     }
     ESP_ERROR_CHECK(err);
 
+#ifdef CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+    ota_verify_start(); // New firmware must connect to Wi-Fi before deadline
+#endif
+
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     s_wifi_sta_netif = esp_netif_create_default_wifi_sta();
@@ -4,8 +4,30 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <esp_http_server.h>
 
+/**
+ * @brief New firmware verification outcome, stored as u8 key "ota_result" in NVS namespace "wifiprovcare".
+ *        Verification time in milliseconds stored as u32 key "ota_verify_ms".
+ */
+typedef enum {
+    WIFI_PROVISION_CARE_OTA_VALID = 1,             /*!< Wi-Fi connected and health check passed, firmware marked valid */
+    WIFI_PROVISION_CARE_OTA_NO_WIFI = 2,           /*!< Wi-Fi not connected before deadline, rollback */
+    WIFI_PROVISION_CARE_OTA_CHECK_FAILED = 3,      /*!< Application health check not passed before deadline, rollback */
+    WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED = 4,   /*!< Verification failed, but no valid firmware to roll back to */
+    WIFI_PROVISION_CARE_OTA_MARK_VALID_FAILED = 5, /*!< Verification passed, but firmware not marked valid, rollback on next reset */
+} wifi_provision_care_ota_result_t;
+
+/**
+ * @brief Application health check callback.
+ *        Called about once per second after new firmware connected to Wi-Fi,
+ *        until it returns true or CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT expires.
+ *
+ * @return true if application is healthy and firmware can be marked valid.
+ */
+typedef bool (*wifi_provision_care_health_check_t)(void);
+
 /**
  * @brief  Tries to connect to Wi-Fi Access Point with 
  *         credentials stored in default NVS partition
@@ -18,6 +40,17 @@ extern "C" {
  */
 void wifi_provision_care(char *ap_ssid_name);
 
+/**
+ * @brief Set application health check used to confirm new firmware after update over the air.
+ *        Requires CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE. Call before wifi_provision_care().
+ *        New firmware must connect to Wi-Fi and pass health check within
+ *        CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT seconds, otherwise it is rolled back.
+ *
+ * @param  health_check Application callback. NULL - Wi-Fi connection only is enough.
+ *
+ */
+void wifi_provision_care_set_health_check(wifi_provision_care_health_check_t health_check);
+
 /**
  * @brief Register POST handler with desired URI to handle upload firmware over te air
  *        const httpd_uri_t updateota_uri =  { .uri = "/updateota", .method = HTTP_POST, .handler = updateota_post_handler };
@@ -30,6 +63,41 @@ void wifi_provision_care(char *ap_ssid_name);
  */
 esp_err_t wifi_provision_care_updateota_post_handler(httpd_req_t *req);
 
+/**
+ * @brief Download firmware from HTTP server and update over the air. Blocks until download finished.
+ *        Server must support range requests. Firmware downloaded in parallel ranges over keep-alive connections,
+ *        interrupted or refused (e.g. 503) range retried from last received byte.
+ *        On success restarts to new firmware after 3 seconds.
+ *
+ * @param  url        Firmware URL, e.g. "http://192.168.1.10:8000/firmware.bin"
+ * @param  sha256_hex Expected firmware SHA-256, 64 hex digits. Get it with sha256sum firmware.bin
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_CRC on SHA-256 mismatch,
+ *         ESP_ERR_NOT_SUPPORTED if server answers range request with whole file, other error codes on failure.
+ */
+esp_err_t wifi_provision_care_pull_ota(const char *url, const char *sha256_hex);
+
+/**
+ * @brief Mount Wi-Fi provisioning portal (/wifi /scanap /savewifi /nvserase /favicon.ico) on application
+ *        http server, so Wi-Fi settings can be changed while connected in STA mode.
+ *        Requires CONFIG_WIFI_PROVISION_CARE_MAINTENANCE, which adds espressif/mdns dependency.
+ *        Portal requires HTTP Basic authentication with CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_USER and
+ *        CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_PASSWORD. Wi-Fi scan and settings save run on low priority
+ *        worker task, one at a time, concurrent request gets "503 Service Unavailable".
+ *        /scanap /savewifi /nvserase also require "X-Requested-With: XMLHttpRequest" header set by portal page,
+ *        cross-site GET without it gets "403 Forbidden".
+ *        Advertises mDNS service "_http._tcp" with path=/wifi, call mdns_init() before.
+ *        Increase httpd_config_t max_uri_handlers by 5.
+ *
+ * @param  server      Application httpd server handle
+ * @param  server_port Application httpd server port, used in mDNS service record
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if maintenance password is not set,
+ *         ESP_ERR_NOT_SUPPORTED if CONFIG_WIFI_PROVISION_CARE_MAINTENANCE disabled,
+ *         httpd_register_uri_handler() error, e.g. ESP_ERR_HTTPD_HANDLERS_FULL.
+ */
+esp_err_t wifi_provision_care_maintenance_start(httpd_handle_t server, uint16_t server_port);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,20 @@
+// Host shim of cJSON, only builders and printer used by the component
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cJSON cJSON;
+
+cJSON *cJSON_CreateArray(void);
+cJSON *cJSON_CreateObject(void);
+void cJSON_AddItemToArray(cJSON *array, cJSON *item);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+char *cJSON_Print(const cJSON *item);
+void cJSON_Delete(cJSON *item);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,203 @@
+// Host shim of cJSON builders and printer. Output matches cJSON_Print() formatting for flat arrays of objects.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+
+typedef enum {
+    SHIM_JSON_ARRAY,
+    SHIM_JSON_OBJECT,
+    SHIM_JSON_STRING,
+    SHIM_JSON_NUMBER,
+} shim_json_type_t;
+
+struct cJSON {
+    shim_json_type_t type;
+    char            *name;
+    char            *string;
+    double           number;
+    cJSON           *child;
+    cJSON           *next;
+};
+
+static cJSON *json_new(shim_json_type_t type)
+{
+    cJSON *item = calloc(1, sizeof(cJSON));
+    if (item != NULL)
+    {
+        item->type = type;
+    }
+    return item;
+}
+
+static void json_append(cJSON *parent, cJSON *item)
+{
+    cJSON **tail = &parent->child;
+    while (*tail != NULL)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = item;
+}
+
+cJSON *cJSON_CreateArray(void)
+{
+    return json_new(SHIM_JSON_ARRAY);
+}
+
+cJSON *cJSON_CreateObject(void)
+{
+    return json_new(SHIM_JSON_OBJECT);
+}
+
+void cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    if (array != NULL && item != NULL)
+    {
+        json_append(array, item);
+    }
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    cJSON *item = json_new(SHIM_JSON_STRING);
+    if (item == NULL || object == NULL)
+    {
+        free(item);
+        return NULL;
+    }
+    item->name = strdup(name);
+    item->string = strdup(string);
+    json_append(object, item);
+    return item;
+}
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    cJSON *item = json_new(SHIM_JSON_NUMBER);
+    if (item == NULL || object == NULL)
+    {
+        free(item);
+        return NULL;
+    }
+    item->name = strdup(name);
+    item->number = number;
+    json_append(object, item);
+    return item;
+}
+
+typedef struct {
+    char  *buf;
+    size_t len;
+    size_t size;
+} json_out_t;
+
+static void out_append(json_out_t *out, const char *s, size_t n)
+{
+    if (out->len + n + 1 > out->size)
+    {
+        out->size = (out->len + n + 1) * 2;
+        out->buf = realloc(out->buf, out->size);
+    }
+    memcpy(out->buf + out->len, s, n);
+    out->len += n;
+    out->buf[out->len] = '\0';
+}
+
+static void out_str(json_out_t *out, const char *s)
+{
+    out_append(out, s, strlen(s));
+}
+
+static void out_quoted(json_out_t *out, const char *s)
+{
+    out_str(out, "\"");
+    for (; *s != '\0'; s++)
+    {
+        char esc[8];
+        if (*s == '"' || *s == '\\')
+        {
+            snprintf(esc, sizeof(esc), "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)*s);
+        } else {
+            esc[0] = *s;
+            esc[1] = '\0';
+        }
+        out_str(out, esc);
+    }
+    out_str(out, "\"");
+}
+
+static void out_indent(json_out_t *out, int depth)
+{
+    for (int i = 0; i < depth; i++)
+    {
+        out_str(out, "\t");
+    }
+}
+
+static void json_print(json_out_t *out, const cJSON *item, int depth)
+{
+    char num[32];
+    switch (item->type)
+    {
+    case SHIM_JSON_STRING:
+        out_quoted(out, item->string);
+        break;
+    case SHIM_JSON_NUMBER:
+        snprintf(num, sizeof(num), "%g", item->number);
+        out_str(out, num);
+        break;
+    case SHIM_JSON_ARRAY:
+        out_str(out, "[");
+        for (const cJSON *c = item->child; c != NULL; c = c->next)
+        {
+            json_print(out, c, depth + 1);
+            if (c->next != NULL)
+            {
+                out_str(out, ", ");
+            }
+        }
+        out_str(out, "]");
+        break;
+    case SHIM_JSON_OBJECT:
+        out_str(out, "{\n");
+        for (const cJSON *c = item->child; c != NULL; c = c->next)
+        {
+            out_indent(out, depth + 1);
+            out_quoted(out, c->name);
+            out_str(out, ":\t");
+            json_print(out, c, depth + 1);
+            out_str(out, (c->next != NULL) ? ",\n" : "\n");
+        }
+        out_indent(out, depth);
+        out_str(out, "}");
+        break;
+    }
+}
+
+char *cJSON_Print(const cJSON *item)
+{
+    if (item == NULL)
+    {
+        return NULL;
+    }
+    json_out_t out = { 0 };
+    out_str(&out, "");
+    json_print(&out, item, 0);
+    return out.buf;
+}
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item != NULL)
+    {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->name);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
@@ -0,0 +1,386 @@
+// Host shim of esp_http_client. Plain HTTP/1.1 over POSIX sockets. Like the real client, an open connection
+// is reused by esp_http_client_open() until esp_http_client_close() or the server closes it.
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "shim.h"
+
+#define SHIM_HTTP_MAX_HEADERS 8
+#define SHIM_HTTP_RBUF_SIZE   4096
+
+struct esp_http_client {
+    char                     host[64];
+    char                     port[8];
+    char                     path[256];
+    int                      timeout_ms;
+    esp_http_client_method_t method;
+    bool                     keep_alive;
+    struct {
+        char *key;
+        char *value;
+    } headers[SHIM_HTTP_MAX_HEADERS];
+    int                      fd;
+    bool                     server_close;    // Response had "Connection: close"
+    int                      status;
+    int64_t                  content_length;
+    int64_t                  body_remaining;
+    char                     rbuf[SHIM_HTTP_RBUF_SIZE];
+    size_t                   rpos;
+    size_t                   rlen;
+};
+
+static int s_connects = 0;
+
+int shim_http_client_connects(void)
+{
+    return __atomic_load_n(&s_connects, __ATOMIC_SEQ_CST);
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    if (config == NULL || config->url == NULL || strncmp(config->url, "http://", 7) != 0)
+    {
+        return NULL;
+    }
+    esp_http_client_handle_t client = calloc(1, sizeof(struct esp_http_client));
+    if (client == NULL)
+    {
+        return NULL;
+    }
+    const char *host = config->url + 7;
+    const char *path = strchr(host, '/');
+    const size_t hostport_len = (path != NULL) ? (size_t)(path - host) : strlen(host);
+    char hostport[sizeof(client->host) + sizeof(client->port)];
+    snprintf(hostport, sizeof(hostport), "%.*s", (int)hostport_len, host);
+    char *colon = strchr(hostport, ':');
+    if (colon != NULL)
+    {
+        *colon = '\0';
+        snprintf(client->port, sizeof(client->port), "%s", colon + 1);
+    } else {
+        strcpy(client->port, "80");
+    }
+    snprintf(client->host, sizeof(client->host), "%.*s", (int)sizeof(client->host) - 1, hostport);
+    snprintf(client->path, sizeof(client->path), "%s", (path != NULL) ? path : "/");
+    client->timeout_ms = (config->timeout_ms > 0) ? config->timeout_ms : 5000;
+    client->method = config->method;
+    client->keep_alive = config->keep_alive_enable;
+    client->fd = -1;
+    return client;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+    }
+    client->rpos = client->rlen = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client == NULL)
+    {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    for (int i = 0; i < SHIM_HTTP_MAX_HEADERS; i++)
+    {
+        free(client->headers[i].key);
+        free(client->headers[i].value);
+    }
+    free(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    int slot = -1;
+    for (int i = 0; i < SHIM_HTTP_MAX_HEADERS; i++)
+    {
+        if (client->headers[i].key != NULL && strcasecmp(client->headers[i].key, key) == 0)
+        {
+            slot = i;
+            break;
+        }
+        if (client->headers[i].key == NULL && slot < 0)
+        {
+            slot = i;
+        }
+    }
+    if (slot < 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (client->headers[slot].key == NULL)
+    {
+        client->headers[slot].key = strdup(key);
+    }
+    free(client->headers[slot].value);
+    client->headers[slot].value = strdup(value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+// Reused socket is dead if server closed it while idle
+static bool connection_alive(esp_http_client_handle_t client)
+{
+    if (client->fd < 0 || client->server_close || client->body_remaining > 0)
+    {
+        return false;
+    }
+    struct pollfd pfd = { .fd = client->fd, .events = POLLIN };
+    if (poll(&pfd, 1, 0) == 0)
+    {
+        return true;
+    }
+    char c;
+    return recv(client->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+}
+
+static esp_err_t connection_open(esp_http_client_handle_t client)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(client->host, client->port, &hints, &res) != 0 || res == NULL)
+    {
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0)
+    {
+        freeaddrinfo(res);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    struct timeval tv = { .tv_sec = client->timeout_ms / 1000, .tv_usec = (client->timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd, res->ai_addr, res->ai_addrlen) != 0)
+    {
+        close(fd);
+        freeaddrinfo(res);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    freeaddrinfo(res);
+    client->fd = fd;
+    client->server_close = false;
+    client->body_remaining = 0;
+    client->rpos = client->rlen = 0;
+    __atomic_add_fetch(&s_connects, 1, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+}
+
+static bool send_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    if (!connection_alive(client))
+    {
+        esp_http_client_close(client);
+        esp_err_t err = connection_open(client);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+    static const char *const methods[] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+    char request[1024];
+    int n = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n",
+                     methods[client->method], client->path, client->host);
+    for (int i = 0; i < SHIM_HTTP_MAX_HEADERS; i++)
+    {
+        if (client->headers[i].key != NULL)
+        {
+            n += snprintf(request + n, sizeof(request) - n, "%s: %s\r\n", client->headers[i].key, client->headers[i].value);
+        }
+    }
+    if (!client->keep_alive)
+    {
+        n += snprintf(request + n, sizeof(request) - n, "Connection: close\r\n");
+    }
+    if (write_len > 0)
+    {
+        n += snprintf(request + n, sizeof(request) - n, "Content-Length: %d\r\n", write_len);
+    }
+    n += snprintf(request + n, sizeof(request) - n, "\r\n");
+    if (!send_all(client->fd, request, n))
+    {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    client->status = 0;
+    client->content_length = -1;
+    return ESP_OK;
+}
+
+// Buffered receive. Returns bytes copied, 0 if connection closed, -1 on error or timeout.
+static int buffered_recv(esp_http_client_handle_t client, char *buf, size_t len)
+{
+    if (client->rpos == client->rlen)
+    {
+        ssize_t n = recv(client->fd, client->rbuf, sizeof(client->rbuf), 0);
+        if (n <= 0)
+        {
+            return (n == 0) ? 0 : -1;
+        }
+        client->rpos = 0;
+        client->rlen = n;
+    }
+    size_t n = client->rlen - client->rpos;
+    if (n > len)
+    {
+        n = len;
+    }
+    memcpy(buf, client->rbuf + client->rpos, n);
+    client->rpos += n;
+    return (int)n;
+}
+
+static int read_line(esp_http_client_handle_t client, char *line, size_t size)
+{
+    size_t len = 0;
+    for (;;)
+    {
+        char c;
+        if (buffered_recv(client, &c, 1) != 1)
+        {
+            return -1;
+        }
+        if (c == '\n')
+        {
+            break;
+        }
+        if (c != '\r' && len + 1 < size)
+        {
+            line[len++] = c;
+        }
+    }
+    line[len] = '\0';
+    return (int)len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    if (client->fd < 0)
+    {
+        return ESP_FAIL;
+    }
+    char line[512];
+    if (read_line(client, line, sizeof(line)) < 0 || sscanf(line, "HTTP/1.%*d %d", &client->status) != 1)
+    {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    client->content_length = -1;
+    client->server_close = !client->keep_alive;
+    int len;
+    while ((len = read_line(client, line, sizeof(line))) > 0)
+    {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            client->content_length = strtoll(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0 && strcasestr(line + 11, "close") != NULL) {
+            client->server_close = true;
+        }
+    }
+    if (len < 0)
+    {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    client->body_remaining = (client->method == HTTP_METHOD_HEAD || client->content_length < 0) ? 0 : client->content_length;
+    return (client->content_length >= 0) ? client->content_length : 0;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    if (client->fd < 0)
+    {
+        return -1;
+    }
+    if (client->body_remaining == 0)
+    {
+        return 0;
+    }
+    if (len > client->body_remaining)
+    {
+        len = (int)client->body_remaining;
+    }
+    int n = buffered_recv(client, buffer, len);
+    if (n <= 0)
+    {
+        esp_http_client_close(client); // Connection dropped mid-body
+        return -1;
+    }
+    client->body_remaining -= n;
+    return n;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client)
+{
+    return client->content_length;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client)
+{
+    return client->body_remaining == 0;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    if (esp_http_client_fetch_headers(client) < 0)
+    {
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    char buf[512];
+    while (esp_http_client_read(client, buf, sizeof(buf)) > 0)
+    {
+    }
+    if (client->server_close)
+    {
+        esp_http_client_close(client);
+    }
+    return esp_http_client_is_complete_data_received(client) ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,472 @@
+// Host shim of esp_http_server. No sockets: shim_httpd_request() dispatches request to registered URI handler
+// on caller thread and captures response in shim_httpd_exchange_t.
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "esp_http_server.h"
+#include "shim.h"
+
+#define SHIM_HTTPD_MAX_HANDLERS 32
+#define SHIM_HTTPD_MAX_SERVERS  4
+
+typedef struct {
+    httpd_config_t           config;
+    httpd_uri_t              handlers[SHIM_HTTPD_MAX_HANDLERS];
+    int                      handler_count;
+    httpd_err_handler_func_t err_handlers[HTTPD_ERR_CODE_MAX];
+} shim_httpd_t;
+
+typedef struct {
+    shim_httpd_exchange_t *ex;
+    size_t                 body_pos;
+    bool                   status_set;
+} shim_req_aux_t;
+
+static pthread_mutex_t s_httpd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static shim_httpd_t   *s_servers[SHIM_HTTPD_MAX_SERVERS]; // Owned by httpd task on target
+static pthread_cond_t  s_httpd_cond;
+static pthread_once_t  s_httpd_once = PTHREAD_ONCE_INIT;
+
+static void httpd_init_once(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_httpd_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static shim_httpd_exchange_t *req_exchange(httpd_req_t *r)
+{
+    return ((shim_req_aux_t *)r->aux)->ex;
+}
+
+static void exchange_done(shim_httpd_exchange_t *ex)
+{
+    pthread_mutex_lock(&s_httpd_mutex);
+    ex->done = true;
+    pthread_cond_broadcast(&s_httpd_cond);
+    pthread_mutex_unlock(&s_httpd_mutex);
+}
+
+// MARK: server
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    pthread_once(&s_httpd_once, httpd_init_once);
+    if (handle == NULL || config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    shim_httpd_t *server = calloc(1, sizeof(shim_httpd_t));
+    if (server == NULL)
+    {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    server->config = *config;
+    pthread_mutex_lock(&s_httpd_mutex);
+    for (int i = 0; i < SHIM_HTTPD_MAX_SERVERS; i++)
+    {
+        if (s_servers[i] == NULL)
+        {
+            s_servers[i] = server;
+            *handle = server;
+            pthread_mutex_unlock(&s_httpd_mutex);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_httpd_mutex);
+    free(server);
+    return ESP_ERR_HTTPD_TASK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    shim_httpd_t *server = handle;
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_httpd_mutex);
+    for (int i = 0; i < SHIM_HTTPD_MAX_SERVERS; i++)
+    {
+        if (s_servers[i] == server)
+        {
+            s_servers[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_httpd_mutex);
+    for (int i = 0; i < server->handler_count; i++)
+    {
+        free((void *)server->handlers[i].uri);
+    }
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    shim_httpd_t *server = handle;
+    if (server == NULL || uri_handler == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_httpd_mutex);
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < server->handler_count; i++)
+    {
+        if (server->handlers[i].method == uri_handler->method && strcmp(server->handlers[i].uri, uri_handler->uri) == 0)
+        {
+            err = ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (err == ESP_OK && (server->handler_count >= server->config.max_uri_handlers ||
+                          server->handler_count >= SHIM_HTTPD_MAX_HANDLERS))
+    {
+        err = ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    if (err == ESP_OK)
+    {
+        server->handlers[server->handler_count] = *uri_handler;
+        server->handlers[server->handler_count].uri = strdup(uri_handler->uri);
+        server->handler_count++;
+    }
+    pthread_mutex_unlock(&s_httpd_mutex);
+    return err;
+}
+
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char *uri, httpd_method_t method)
+{
+    shim_httpd_t *server = handle;
+    if (server == NULL || uri == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_httpd_mutex);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    for (int i = 0; i < server->handler_count; i++)
+    {
+        if (server->handlers[i].method == method && strcmp(server->handlers[i].uri, uri) == 0)
+        {
+            free((void *)server->handlers[i].uri);
+            memmove(&server->handlers[i], &server->handlers[i + 1], (server->handler_count - i - 1) * sizeof(httpd_uri_t));
+            server->handler_count--;
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_httpd_mutex);
+    return err;
+}
+
+esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t error, httpd_err_handler_func_t handler_fn)
+{
+    shim_httpd_t *server = handle;
+    if (server == NULL || error >= HTTPD_ERR_CODE_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    server->err_handlers[error] = handler_fn;
+    return ESP_OK;
+}
+
+int shim_httpd_handler_count(httpd_handle_t handle)
+{
+    shim_httpd_t *server = handle;
+    pthread_mutex_lock(&s_httpd_mutex);
+    int count = server->handler_count;
+    pthread_mutex_unlock(&s_httpd_mutex);
+    return count;
+}
+
+// MARK: request dispatch
+esp_err_t shim_httpd_request(httpd_handle_t handle, httpd_method_t method, const char *uri, shim_httpd_exchange_t *ex)
+{
+    shim_httpd_t *server = handle;
+    shim_req_aux_t aux = { .ex = ex };
+    httpd_req_t req = { .handle = handle, .method = method, .content_len = ex->body_len, .aux = &aux };
+    strncpy((char *)req.uri, uri, HTTPD_MAX_URI_LEN);
+    ex->done = false;
+    ex->async = false;
+
+    const httpd_uri_t *match = NULL;
+    pthread_mutex_lock(&s_httpd_mutex);
+    for (int i = 0; i < server->handler_count; i++)
+    {
+        if (server->handlers[i].method == method && strcmp(server->handlers[i].uri, uri) == 0)
+        {
+            match = &server->handlers[i];
+        }
+    }
+    pthread_mutex_unlock(&s_httpd_mutex);
+
+    esp_err_t err;
+    if (match != NULL)
+    {
+        req.user_ctx = match->user_ctx;
+        err = match->handler(&req);
+    } else if (server->err_handlers[HTTPD_404_NOT_FOUND] != NULL) {
+        err = server->err_handlers[HTTPD_404_NOT_FOUND](&req, HTTPD_404_NOT_FOUND);
+    } else {
+        err = httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, NULL);
+    }
+    if (!ex->async)
+    {
+        exchange_done(ex);
+    }
+    return err;
+}
+
+bool shim_httpd_wait(shim_httpd_exchange_t *ex, uint32_t timeout_ms)
+{
+    pthread_once(&s_httpd_once, httpd_init_once);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&s_httpd_mutex);
+    while (!ex->done)
+    {
+        if (pthread_cond_timedwait(&s_httpd_cond, &s_httpd_mutex, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    const bool done = ex->done;
+    pthread_mutex_unlock(&s_httpd_mutex);
+    return done;
+}
+
+void shim_httpd_exchange_free(shim_httpd_exchange_t *ex)
+{
+    free(ex->resp);
+    ex->resp = NULL;
+    ex->resp_len = 0;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    if (r == NULL || out == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_req_t *async = malloc(sizeof(httpd_req_t));
+    shim_req_aux_t *aux = malloc(sizeof(shim_req_aux_t));
+    if (async == NULL || aux == NULL)
+    {
+        free(async);
+        free(aux);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(async, r, sizeof(httpd_req_t));
+    memcpy(aux, r->aux, sizeof(shim_req_aux_t));
+    async->aux = aux;
+    req_exchange(r)->async = true;
+    *out = async;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    if (r == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    exchange_done(req_exchange(r));
+    free(r->aux);
+    free(r);
+    return ESP_OK;
+}
+
+// MARK: response
+static void copy_field(char *dst, size_t dst_size, const char *src)
+{
+    strncpy(dst, src, dst_size - 1);
+    dst[dst_size - 1] = '\0';
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    copy_field(req_exchange(r)->status, sizeof(req_exchange(r)->status), status);
+    ((shim_req_aux_t *)r->aux)->status_set = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    copy_field(req_exchange(r)->content_type, sizeof(req_exchange(r)->content_type), type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    shim_httpd_exchange_t *ex = req_exchange(r);
+    if (strcasecmp(field, "Location") == 0)
+    {
+        copy_field(ex->location, sizeof(ex->location), value);
+    } else if (strcasecmp(field, "WWW-Authenticate") == 0) {
+        copy_field(ex->www_authenticate, sizeof(ex->www_authenticate), value);
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    shim_httpd_exchange_t *ex = req_exchange(r);
+    if (!((shim_req_aux_t *)r->aux)->status_set)
+    {
+        httpd_resp_set_status(r, "200 OK");
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN)
+    {
+        buf_len = (buf != NULL) ? strlen(buf) : 0;
+    }
+    free(ex->resp);
+    ex->resp = malloc(buf_len + 1);
+    if (ex->resp == NULL)
+    {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    if (buf_len > 0)
+    {
+        memcpy(ex->resp, buf, buf_len);
+    }
+    ex->resp[buf_len] = '\0';
+    ex->resp_len = buf_len;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+    return httpd_resp_send(r, str, (str != NULL) ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const char *const status[HTTPD_ERR_CODE_MAX] = {
+        [HTTPD_500_INTERNAL_SERVER_ERROR]    = "500 Internal Server Error",
+        [HTTPD_501_METHOD_NOT_IMPLEMENTED]   = "501 Method Not Implemented",
+        [HTTPD_505_VERSION_NOT_SUPPORTED]    = "505 Version Not Supported",
+        [HTTPD_400_BAD_REQUEST]              = "400 Bad Request",
+        [HTTPD_401_UNAUTHORIZED]             = "401 Unauthorized",
+        [HTTPD_403_FORBIDDEN]                = "403 Forbidden",
+        [HTTPD_404_NOT_FOUND]                = "404 Not Found",
+        [HTTPD_405_METHOD_NOT_ALLOWED]       = "405 Method Not Allowed",
+        [HTTPD_408_REQ_TIMEOUT]              = "408 Request Timeout",
+        [HTTPD_411_LENGTH_REQUIRED]          = "411 Length Required",
+        [HTTPD_414_URI_TOO_LONG]             = "414 URI Too Long",
+        [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = "431 Request Header Fields Too Large",
+    };
+    if (error >= HTTPD_ERR_CODE_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_resp_set_status(req, status[error]);
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, msg != NULL ? msg : status[error], HTTPD_RESP_USE_STRLEN);
+}
+
+// MARK: request
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    shim_req_aux_t *aux = r->aux;
+    shim_httpd_exchange_t *ex = aux->ex;
+    size_t n = ex->body_len - aux->body_pos;
+    if (n > buf_len)
+    {
+        n = buf_len;
+    }
+    if (ex->recv_chunk > 0 && n > ex->recv_chunk)
+    {
+        n = ex->recv_chunk;
+    }
+    memcpy(buf, ex->body + aux->body_pos, n);
+    aux->body_pos += n;
+    return (int)n;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    const char *query = req_exchange(r)->query;
+    return (query != NULL) ? strlen(query) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *query = req_exchange(r)->query;
+    if (query == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (buf == NULL || buf_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    copy_field(buf, buf_len, query);
+    return (strlen(query) >= buf_len) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    if (qry == NULL || key == NULL || val == NULL || val_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const size_t key_len = strlen(key);
+    for (const char *p = qry; p != NULL && *p != '\0'; )
+    {
+        const char *end = strchr(p, '&');
+        const size_t pair_len = (end != NULL) ? (size_t)(end - p) : strlen(p);
+        if (pair_len > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=')
+        {
+            const size_t value_len = pair_len - key_len - 1;
+            const size_t n = (value_len < val_size - 1) ? value_len : val_size - 1;
+            memcpy(val, p + key_len + 1, n);
+            val[n] = '\0';
+            return (value_len > n) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        p = (end != NULL) ? end + 1 : NULL;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static const char *req_hdr(httpd_req_t *r, const char *field)
+{
+    if (strcasecmp(field, "Authorization") == 0)
+    {
+        return req_exchange(r)->authorization;
+    }
+    if (strcasecmp(field, "X-Requested-With") == 0)
+    {
+        return req_exchange(r)->requested_with;
+    }
+    return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    const char *value = req_hdr(r, field);
+    return (value != NULL) ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    const char *value = req_hdr(r, field);
+    if (value == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (val == NULL || val_size == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    copy_field(val, val_size, value);
+    return (strlen(value) >= val_size) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
@@ -0,0 +1,101 @@
+// Host shim of ESP-IDF esp_netif.h
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    uint32_t addr[4];
+    uint8_t  zone;
+} esp_ip6_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    esp_ip6_addr_t ip;
+} esp_netif_ip6_info_t;
+
+typedef enum {
+    ESP_NETIF_OP_START = 0,
+    ESP_NETIF_OP_SET,
+    ESP_NETIF_OP_GET,
+} esp_netif_dhcp_option_mode_t;
+
+typedef enum {
+    ESP_NETIF_SUBNET_MASK = 1,
+    ESP_NETIF_DOMAIN_NAME_SERVER = 6,
+    ESP_NETIF_ROUTER_SOLICITATION_ADDRESS = 32,
+    ESP_NETIF_REQUESTED_IP_ADDRESS = 50,
+    ESP_NETIF_IP_ADDRESS_LEASE_TIME = 51,
+    ESP_NETIF_IP_REQUEST_RETRY_TIME = 52,
+    ESP_NETIF_VENDOR_CLASS_IDENTIFIER = 60,
+    ESP_NETIF_VENDOR_SPECIFIC_INFO = 43,
+    ESP_NETIF_CAPTIVEPORTAL_URI = 114,
+} esp_netif_dhcp_option_id_t;
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+    IP_EVENT_GOT_IP6,
+    IP_EVENT_ETH_GOT_IP,
+    IP_EVENT_ETH_LOST_IP,
+} ip_event_t;
+
+typedef struct {
+    esp_netif_t        *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool                ip_changed;
+} ip_event_got_ip_t;
+
+typedef struct {
+    esp_netif_t         *esp_netif;
+    esp_netif_ip6_info_t ip6_info;
+    int                  ip_index;
+} ip_event_got_ip6_t;
+
+#define esp_ip4_addr_get_byte(ipaddr, idx) (((const uint8_t*)(&(ipaddr)->addr))[idx])
+#define IP2STR(ipaddr) esp_ip4_addr_get_byte(ipaddr, 0), esp_ip4_addr_get_byte(ipaddr, 1), \
+                       esp_ip4_addr_get_byte(ipaddr, 2), esp_ip4_addr_get_byte(ipaddr, 3)
+#define IPSTR "%d.%d.%d.%d"
+#define IPV62STR(ipaddr) (int)((ipaddr).addr[0] & 0xffff), (int)(((ipaddr).addr[0] >> 16) & 0xffff), \
+                         (int)((ipaddr).addr[1] & 0xffff), (int)(((ipaddr).addr[1] >> 16) & 0xffff), \
+                         (int)((ipaddr).addr[2] & 0xffff), (int)(((ipaddr).addr[2] >> 16) & 0xffff), \
+                         (int)((ipaddr).addr[3] & 0xffff), (int)(((ipaddr).addr[3] >> 16) & 0xffff)
+#define IPV6STR "%04x:%04x:%04x:%04x:%04x:%04x:%04x:%04x"
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_sta(void);
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key);
+esp_netif_t *esp_netif_get_default_netif(void);
+const char *esp_netif_get_desc(esp_netif_t *esp_netif);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *esp_netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_dhcps_start(esp_netif_t *esp_netif);
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *esp_netif);
+esp_err_t esp_netif_dhcps_option(esp_netif_t *esp_netif, esp_netif_dhcp_option_mode_t opt_op,
+                                 esp_netif_dhcp_option_id_t opt_id, void *opt_val, uint32_t opt_len);
+esp_err_t esp_netif_create_ip6_linklocal(esp_netif_t *esp_netif);
+
+#ifdef __cplusplus
+}
+#endif
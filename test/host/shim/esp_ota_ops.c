@@ -0,0 +1,294 @@
+// Host shim of app_update. Running image is in ota_0, update goes to ota_1. Images are kept in RAM.
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "shim.h"
+
+#define SHIM_OTA_PARTITION_SIZE (1024 * 1024)
+#define SHIM_OTA_IMAGE_MAGIC    0xE9 // ESP_IMAGE_HEADER_MAGIC
+
+static const esp_partition_t s_partitions[2] = {
+    { .address = 0x10000,  .size = SHIM_OTA_PARTITION_SIZE, .label = "ota_0" },
+    { .address = 0x110000, .size = SHIM_OTA_PARTITION_SIZE, .label = "ota_1" },
+};
+
+typedef struct {
+    esp_ota_img_states_t state;
+    uint8_t             *image;
+    size_t               image_len;
+} shim_partition_state_t;
+
+shim_ota_t shim_ota;
+
+static pthread_mutex_t        s_ota_mutex = PTHREAD_MUTEX_INITIALIZER;
+static shim_partition_state_t s_state[2] = { { .state = ESP_OTA_IMG_VALID }, { .state = ESP_OTA_IMG_UNDEFINED } };
+static int                    s_running = 0;
+static int                    s_boot = 0;
+// Single update in progress
+static esp_ota_handle_t       s_handle = 0;
+static esp_ota_handle_t       s_next_handle = 1;
+static int                    s_handle_partition = -1;
+static uint8_t               *s_write_buf = NULL;
+static size_t                 s_write_len = 0;
+
+static int partition_index(const esp_partition_t *partition)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (partition == &s_partitions[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void shim_ota_reset(void)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    for (int i = 0; i < 2; i++)
+    {
+        free(s_state[i].image);
+        s_state[i].image = NULL;
+        s_state[i].image_len = 0;
+    }
+    s_state[0].state = ESP_OTA_IMG_VALID;
+    s_state[1].state = ESP_OTA_IMG_UNDEFINED;
+    s_running = 0;
+    s_boot = 0;
+    free(s_write_buf);
+    s_write_buf = NULL;
+    s_write_len = 0;
+    s_handle = 0;
+    s_handle_partition = -1;
+    memset(&shim_ota, 0, sizeof(shim_ota));
+    pthread_mutex_unlock(&s_ota_mutex);
+}
+
+void shim_ota_set_state(const esp_partition_t *partition, esp_ota_img_states_t state)
+{
+    int i = partition_index(partition);
+    if (i >= 0)
+    {
+        pthread_mutex_lock(&s_ota_mutex);
+        s_state[i].state = state;
+        pthread_mutex_unlock(&s_ota_mutex);
+    }
+}
+
+const uint8_t *shim_ota_image(const esp_partition_t *partition, size_t *size)
+{
+    int i = partition_index(partition);
+    if (i < 0)
+    {
+        return NULL;
+    }
+    pthread_mutex_lock(&s_ota_mutex);
+    const uint8_t *image = s_state[i].image;
+    *size = s_state[i].image_len;
+    pthread_mutex_unlock(&s_ota_mutex);
+    return image;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return &s_partitions[s_running];
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+    return &s_partitions[s_boot];
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    if (shim_ota.no_update_partition)
+    {
+        return NULL;
+    }
+    return &s_partitions[1 - s_running];
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    const int i = partition_index(partition);
+    if (i < 0 || out_handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (i == s_running)
+    {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+    if (image_size != OTA_SIZE_UNKNOWN && image_size != OTA_WITH_SEQUENTIAL_WRITES && image_size > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    pthread_mutex_lock(&s_ota_mutex);
+    if (s_handle != 0)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_INVALID_STATE; // Shim supports single update at a time
+    }
+    s_write_buf = malloc(partition->size);
+    if (s_write_buf == NULL)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    s_write_len = 0;
+    s_handle = s_next_handle++;
+    s_handle_partition = i;
+    *out_handle = s_handle;
+    pthread_mutex_unlock(&s_ota_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    if (handle == 0 || handle != s_handle)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_write_len == 0 && size > 0 && ((const uint8_t *)data)[0] != SHIM_OTA_IMAGE_MAGIC)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (s_write_len + size > s_partitions[s_handle_partition].size)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_write_buf + s_write_len, data, size);
+    s_write_len += size;
+    pthread_mutex_unlock(&s_ota_mutex);
+
+    const uint64_t us = (uint64_t)shim_ota.write_us_per_kib * size / 1024;
+    if (us > 0)
+    {
+        struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+    return ESP_OK;
+}
+
+static void handle_release(void)
+{
+    free(s_write_buf);
+    s_write_buf = NULL;
+    s_write_len = 0;
+    s_handle = 0;
+    s_handle_partition = -1;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    if (handle == 0 || handle != s_handle)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    if (s_write_len == 0 || s_write_buf[0] != SHIM_OTA_IMAGE_MAGIC)
+    {
+        err = ESP_ERR_OTA_VALIDATE_FAILED;
+    } else {
+        shim_partition_state_t *p = &s_state[s_handle_partition];
+        free(p->image);
+        p->image = s_write_buf;
+        p->image_len = s_write_len;
+        p->state = ESP_OTA_IMG_NEW;
+        s_write_buf = NULL;
+    }
+    handle_release();
+    pthread_mutex_unlock(&s_ota_mutex);
+    return err;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    if (handle == 0 || handle != s_handle)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    handle_release();
+    pthread_mutex_unlock(&s_ota_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    const int i = partition_index(partition);
+    if (i < 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_ota_mutex);
+    esp_err_t err = ESP_OK;
+    if (i != s_running && s_state[i].image == NULL)
+    {
+        err = ESP_ERR_OTA_VALIDATE_FAILED;
+    } else {
+        s_boot = i;
+    }
+    pthread_mutex_unlock(&s_ota_mutex);
+    return err;
+}
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t *partition, esp_ota_img_states_t *ota_state)
+{
+    const int i = partition_index(partition);
+    if (i < 0 || ota_state == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_ota_mutex);
+    *ota_state = s_state[i].state;
+    pthread_mutex_unlock(&s_ota_mutex);
+    return (*ota_state == ESP_OTA_IMG_UNDEFINED) ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    s_state[s_running].state = ESP_OTA_IMG_VALID;
+    shim_ota.mark_valid_calls++;
+    pthread_mutex_unlock(&s_ota_mutex);
+    return ESP_OK;
+}
+
+bool esp_ota_check_rollback_is_possible(void)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    const bool possible = (s_state[1 - s_running].state == ESP_OTA_IMG_VALID);
+    pthread_mutex_unlock(&s_ota_mutex);
+    return possible;
+}
+
+// Real function does not return on success. Shim counts esp_restart() and returns ESP_OK.
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot(void)
+{
+    pthread_mutex_lock(&s_ota_mutex);
+    shim_ota.rollback_calls++;
+    const int other = 1 - s_running;
+    if (s_state[other].state != ESP_OTA_IMG_VALID)
+    {
+        pthread_mutex_unlock(&s_ota_mutex);
+        return ESP_ERR_OTA_ROLLBACK_FAILED;
+    }
+    s_state[s_running].state = ESP_OTA_IMG_INVALID;
+    s_boot = other;
+    pthread_mutex_unlock(&s_ota_mutex);
+    esp_restart();
+    return ESP_OK;
+}
@@ -0,0 +1,163 @@
+// Host shim of esp_system, esp_err, esp_log and esp_mac
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "esp_ota_ops.h"
+#include "esp_http_server.h"
+#include "esp_http_client.h"
+#include "nvs.h"
+#include "lwip/inet.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "shim.h"
+
+// MARK: esp_err
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+#define ERR_NAME(x) case x: return #x;
+    ERR_NAME(ESP_OK)
+    ERR_NAME(ESP_FAIL)
+    ERR_NAME(ESP_ERR_NO_MEM)
+    ERR_NAME(ESP_ERR_INVALID_ARG)
+    ERR_NAME(ESP_ERR_INVALID_STATE)
+    ERR_NAME(ESP_ERR_INVALID_SIZE)
+    ERR_NAME(ESP_ERR_NOT_FOUND)
+    ERR_NAME(ESP_ERR_NOT_SUPPORTED)
+    ERR_NAME(ESP_ERR_TIMEOUT)
+    ERR_NAME(ESP_ERR_INVALID_RESPONSE)
+    ERR_NAME(ESP_ERR_INVALID_CRC)
+    ERR_NAME(ESP_ERR_WIFI_NOT_INIT)
+    ERR_NAME(ESP_ERR_WIFI_NOT_STARTED)
+    ERR_NAME(ESP_ERR_WIFI_IF)
+    ERR_NAME(ESP_ERR_WIFI_MODE)
+    ERR_NAME(ESP_ERR_WIFI_STATE)
+    ERR_NAME(ESP_ERR_WIFI_NVS)
+    ERR_NAME(ESP_ERR_OTA_PARTITION_CONFLICT)
+    ERR_NAME(ESP_ERR_OTA_SELECT_INFO_INVALID)
+    ERR_NAME(ESP_ERR_OTA_VALIDATE_FAILED)
+    ERR_NAME(ESP_ERR_OTA_SMALL_SEC_VER)
+    ERR_NAME(ESP_ERR_OTA_ROLLBACK_FAILED)
+    ERR_NAME(ESP_ERR_OTA_ROLLBACK_INVALID_STATE)
+    ERR_NAME(ESP_ERR_NVS_NOT_INITIALIZED)
+    ERR_NAME(ESP_ERR_NVS_NOT_FOUND)
+    ERR_NAME(ESP_ERR_NVS_TYPE_MISMATCH)
+    ERR_NAME(ESP_ERR_NVS_READ_ONLY)
+    ERR_NAME(ESP_ERR_NVS_NOT_ENOUGH_SPACE)
+    ERR_NAME(ESP_ERR_NVS_INVALID_NAME)
+    ERR_NAME(ESP_ERR_NVS_INVALID_HANDLE)
+    ERR_NAME(ESP_ERR_NVS_INVALID_LENGTH)
+    ERR_NAME(ESP_ERR_NVS_NO_FREE_PAGES)
+    ERR_NAME(ESP_ERR_NVS_NEW_VERSION_FOUND)
+    ERR_NAME(ESP_ERR_NVS_KEY_TOO_LONG)
+    ERR_NAME(ESP_ERR_HTTPD_HANDLERS_FULL)
+    ERR_NAME(ESP_ERR_HTTPD_HANDLER_EXISTS)
+    ERR_NAME(ESP_ERR_HTTPD_INVALID_REQ)
+    ERR_NAME(ESP_ERR_HTTPD_RESULT_TRUNC)
+    ERR_NAME(ESP_ERR_HTTPD_RESP_HDR)
+    ERR_NAME(ESP_ERR_HTTPD_RESP_SEND)
+    ERR_NAME(ESP_ERR_HTTPD_ALLOC_MEM)
+    ERR_NAME(ESP_ERR_HTTPD_TASK)
+    ERR_NAME(ESP_ERR_HTTP_MAX_REDIRECT)
+    ERR_NAME(ESP_ERR_HTTP_CONNECT)
+    ERR_NAME(ESP_ERR_HTTP_WRITE_DATA)
+    ERR_NAME(ESP_ERR_HTTP_FETCH_HEADER)
+    ERR_NAME(ESP_ERR_HTTP_INVALID_TRANSPORT)
+    ERR_NAME(ESP_ERR_HTTP_CONNECTING)
+    ERR_NAME(ESP_ERR_HTTP_EAGAIN)
+#undef ERR_NAME
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+// MARK: esp_log
+static esp_log_level_t log_level(void)
+{
+    static int level = -1;
+    if (level < 0)
+    {
+        const char *env = getenv("ESP_LOG_LEVEL");
+        level = (env != NULL) ? atoi(env) : ESP_LOG_WARN;
+    }
+    return (esp_log_level_t)level;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > log_level())
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// MARK: esp_system
+static pthread_mutex_t s_restart_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int s_restart_count = 0;
+
+void esp_restart(void)
+{
+    ESP_LOGI("shim", "esp_restart()");
+    pthread_mutex_lock(&s_restart_mutex);
+    s_restart_count++;
+    pthread_mutex_unlock(&s_restart_mutex);
+}
+
+int shim_restart_count(void)
+{
+    pthread_mutex_lock(&s_restart_mutex);
+    int count = s_restart_count;
+    pthread_mutex_unlock(&s_restart_mutex);
+    return count;
+}
+
+bool shim_restart_wait(int count, uint32_t timeout_ms)
+{
+    const uint64_t deadline = shim_time_us() + (uint64_t)timeout_ms * 1000;
+    while (shim_restart_count() < count)
+    {
+        if (shim_time_us() > deadline)
+        {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+// MARK: esp_mac
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    const uint8_t factory_mac[6] = { 0x24, 0x0a, 0xc4, 0x12, 0xab, 0xcd };
+    memcpy(mac, factory_mac, sizeof(factory_mac));
+    return ESP_OK;
+}
+
+// MARK: lwip
+char *shim_ip4addr_ntoa_r(const uint32_t *addr, char *buf, int buflen)
+{
+    const uint8_t *b = (const uint8_t *)addr;
+    snprintf(buf, buflen, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+    return buf;
+}
@@ -0,0 +1,16 @@
+// Host shim of ESP-IDF esp_system.h. esp_restart() only counts restarts, see shim.h.
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_restart(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
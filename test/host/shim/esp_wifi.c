@@ -0,0 +1,469 @@
+// Host shim of default event loop, esp_netif and esp_wifi station/SoftAP driver
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "shim.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+// MARK: event loop
+#define SHIM_MAX_EVENT_HANDLERS 16
+
+typedef struct shim_event {
+    esp_event_base_t   base;
+    int32_t            id;
+    void              *data;
+    struct shim_event *next;
+} shim_event_t;
+
+static struct {
+    esp_event_base_t    base;
+    int32_t             id;
+    esp_event_handler_t handler;
+    void               *arg;
+} s_handlers[SHIM_MAX_EVENT_HANDLERS];
+static pthread_mutex_t s_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  s_event_cond = PTHREAD_COND_INITIALIZER;
+static shim_event_t   *s_event_head = NULL;
+static shim_event_t   *s_event_tail = NULL;
+static bool            s_event_loop_created = false;
+
+static void event_loop_task(void *param)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&s_event_mutex);
+        while (s_event_head == NULL)
+        {
+            pthread_cond_wait(&s_event_cond, &s_event_mutex);
+        }
+        shim_event_t *event = s_event_head;
+        s_event_head = event->next;
+        if (s_event_head == NULL)
+        {
+            s_event_tail = NULL;
+        }
+        pthread_mutex_unlock(&s_event_mutex);
+
+        for (int i = 0; i < SHIM_MAX_EVENT_HANDLERS; i++)
+        {
+            pthread_mutex_lock(&s_event_mutex);
+            esp_event_handler_t handler = s_handlers[i].handler;
+            bool match = handler != NULL && s_handlers[i].base == event->base &&
+                         (s_handlers[i].id == ESP_EVENT_ANY_ID || s_handlers[i].id == event->id);
+            void *arg = s_handlers[i].arg;
+            pthread_mutex_unlock(&s_event_mutex);
+            if (match)
+            {
+                handler(arg, event->base, event->id, event->data);
+            }
+        }
+        free(event->data);
+        free(event);
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    pthread_mutex_lock(&s_event_mutex);
+    if (s_event_loop_created)
+    {
+        pthread_mutex_unlock(&s_event_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_event_loop_created = true;
+    pthread_mutex_unlock(&s_event_mutex);
+    return xTaskCreate(event_loop_task, "sys_evt", 4096, NULL, 20, NULL) == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id,
+                                     esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    pthread_mutex_lock(&s_event_mutex);
+    for (int i = 0; i < SHIM_MAX_EVENT_HANDLERS; i++)
+    {
+        if (s_handlers[i].handler == NULL)
+        {
+            s_handlers[i].base = event_base;
+            s_handlers[i].id = event_id;
+            s_handlers[i].handler = event_handler;
+            s_handlers[i].arg = event_handler_arg;
+            pthread_mutex_unlock(&s_event_mutex);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_event_mutex);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler)
+{
+    pthread_mutex_lock(&s_event_mutex);
+    for (int i = 0; i < SHIM_MAX_EVENT_HANDLERS; i++)
+    {
+        if (s_handlers[i].handler == event_handler && s_handlers[i].base == event_base && s_handlers[i].id == event_id)
+        {
+            s_handlers[i].handler = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_event_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait)
+{
+    shim_event_t *event = calloc(1, sizeof(*event));
+    if (event == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    event->base = event_base;
+    event->id = event_id;
+    if (event_data_size > 0)
+    {
+        event->data = malloc(event_data_size);
+        memcpy(event->data, event_data, event_data_size);
+    }
+    pthread_mutex_lock(&s_event_mutex);
+    if (!s_event_loop_created)
+    {
+        pthread_mutex_unlock(&s_event_mutex);
+        free(event->data);
+        free(event);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_event_tail != NULL)
+    {
+        s_event_tail->next = event;
+    } else {
+        s_event_head = event;
+    }
+    s_event_tail = event;
+    pthread_cond_signal(&s_event_cond);
+    pthread_mutex_unlock(&s_event_mutex);
+    return ESP_OK;
+}
+
+// MARK: esp_netif
+struct esp_netif_obj {
+    const char         *if_key;
+    const char         *desc;
+    esp_netif_ip_info_t ip_info;
+    bool                created;
+};
+
+static esp_netif_t s_netif_sta = { .if_key = "WIFI_STA_DEF", .desc = "sta" };
+static esp_netif_t s_netif_ap  = { .if_key = "WIFI_AP_DEF",  .desc = "ap" };
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    s_netif_sta.created = true;
+    return &s_netif_sta;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_ap(void)
+{
+    s_netif_ap.created = true;
+    s_netif_ap.ip_info.ip.addr = 192 | (168 << 8) | (4 << 16) | (1u << 24);
+    return &s_netif_ap;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key)
+{
+    if (s_netif_sta.created && strcmp(if_key, s_netif_sta.if_key) == 0)
+    {
+        return &s_netif_sta;
+    }
+    if (s_netif_ap.created && strcmp(if_key, s_netif_ap.if_key) == 0)
+    {
+        return &s_netif_ap;
+    }
+    return NULL;
+}
+
+esp_netif_t *esp_netif_get_default_netif(void)
+{
+    return s_netif_sta.created ? &s_netif_sta : NULL;
+}
+
+const char *esp_netif_get_desc(esp_netif_t *esp_netif)
+{
+    return esp_netif != NULL ? esp_netif->desc : NULL;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info)
+{
+    if (esp_netif == NULL || ip_info == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *ip_info = esp_netif->ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *esp_netif, const esp_netif_ip_info_t *ip_info)
+{
+    if (esp_netif == NULL || ip_info == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_netif->ip_info = *ip_info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcps_start(esp_netif_t *esp_netif)
+{
+    return esp_netif != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *esp_netif)
+{
+    return esp_netif != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_netif_dhcps_option(esp_netif_t *esp_netif, esp_netif_dhcp_option_mode_t opt_op,
+                                 esp_netif_dhcp_option_id_t opt_id, void *opt_val, uint32_t opt_len)
+{
+    return esp_netif != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_netif_create_ip6_linklocal(esp_netif_t *esp_netif)
+{
+    return esp_netif != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// MARK: esp_wifi
+#define WIFI_NVS_NAMESPACE "nvs.net80211"
+
+shim_wifi_t shim_wifi = { .connect_ok = true };
+
+static pthread_mutex_t s_wifi_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool            s_wifi_init = false;
+static bool            s_scanning = false;
+static wifi_storage_t  s_storage = WIFI_STORAGE_FLASH;
+static wifi_mode_t     s_mode = WIFI_MODE_NULL;
+static wifi_config_t   s_sta_config;
+static wifi_config_t   s_ap_config;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    pthread_mutex_lock(&s_wifi_mutex);
+    memset(&s_sta_config, 0, sizeof(s_sta_config));
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK)
+    {
+        size_t len = sizeof(s_sta_config.sta.ssid);
+        nvs_get_blob(nvs, "sta.ssid", s_sta_config.sta.ssid, &len);
+        len = sizeof(s_sta_config.sta.password);
+        nvs_get_blob(nvs, "sta.pswd", s_sta_config.sta.password, &len);
+        nvs_close(nvs);
+    }
+    s_storage = WIFI_STORAGE_FLASH;
+    s_wifi_init = true;
+    pthread_mutex_unlock(&s_wifi_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void)
+{
+    s_wifi_init = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    s_storage = storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    s_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+    *mode = s_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    if (interface == WIFI_IF_AP)
+    {
+        pthread_mutex_lock(&s_wifi_mutex);
+        s_ap_config = *conf;
+        pthread_mutex_unlock(&s_wifi_mutex);
+        return ESP_OK;
+    }
+    pthread_mutex_lock(&s_wifi_mutex);
+    s_sta_config = *conf;
+    const bool flash = (s_storage == WIFI_STORAGE_FLASH);
+    pthread_mutex_unlock(&s_wifi_mutex);
+    if (!flash)
+    {
+        return ESP_OK;
+    }
+    vTaskDelay(pdMS_TO_TICKS(shim_wifi.flash_write_ms));
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK)
+    {
+        return ESP_ERR_WIFI_NVS;
+    }
+    nvs_set_blob(nvs, "sta.ssid", conf->sta.ssid, sizeof(conf->sta.ssid));
+    nvs_set_blob(nvs, "sta.pswd", conf->sta.password, sizeof(conf->sta.password));
+    nvs_commit(nvs);
+    nvs_close(nvs);
+    __atomic_add_fetch(&shim_wifi.config_flash_writes, 1, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    pthread_mutex_lock(&s_wifi_mutex);
+    *conf = (interface == WIFI_IF_AP) ? s_ap_config : s_sta_config;
+    pthread_mutex_unlock(&s_wifi_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    if (s_mode == WIFI_MODE_STA || s_mode == WIFI_MODE_APSTA)
+    {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, portMAX_DELAY);
+    }
+    if (s_mode == WIFI_MODE_AP || s_mode == WIFI_MODE_APSTA)
+    {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, portMAX_DELAY);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    const int call = __atomic_add_fetch(&shim_wifi.connect_calls, 1, __ATOMIC_SEQ_CST);
+    if (!shim_wifi.connect_ok || call <= shim_wifi.connect_fail_count)
+    {
+        wifi_event_sta_disconnected_t disconnected = { .reason = 201 }; // WIFI_REASON_NO_AP_FOUND
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &disconnected, sizeof(disconnected), portMAX_DELAY);
+        return ESP_OK;
+    }
+    wifi_event_sta_connected_t connected = { .channel = 6, .authmode = WIFI_AUTH_WPA2_PSK, .bssid = { 0x02, 0, 0, 0, 0, 1 } };
+    pthread_mutex_lock(&s_wifi_mutex);
+    memcpy(connected.ssid, s_sta_config.sta.ssid, sizeof(connected.ssid) - 1);
+    pthread_mutex_unlock(&s_wifi_mutex);
+    connected.ssid_len = strlen((char *)connected.ssid);
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &connected, sizeof(connected), portMAX_DELAY);
+
+    ip_event_got_ip_t got_ip = { .esp_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF"), .ip_changed = true };
+    got_ip.ip_info.ip.addr = 192 | (168 << 8) | (1 << 16) | (50u << 24);
+    if (got_ip.esp_netif != NULL)
+    {
+        esp_netif_set_ip_info(got_ip.esp_netif, &got_ip.ip_info);
+    }
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_restore(void)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    pthread_mutex_lock(&s_wifi_mutex);
+    memset(&s_sta_config, 0, sizeof(s_sta_config));
+    memset(&s_ap_config, 0, sizeof(s_ap_config));
+    s_storage = WIFI_STORAGE_FLASH;
+    pthread_mutex_unlock(&s_wifi_mutex);
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK)
+    {
+        nvs_erase_all(nvs);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    __atomic_add_fetch(&shim_wifi.restores, 1, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    if (!s_wifi_init)
+    {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    pthread_mutex_lock(&s_wifi_mutex);
+    if (s_scanning)
+    {
+        pthread_mutex_unlock(&s_wifi_mutex);
+        return ESP_ERR_WIFI_STATE; // Scan already in progress
+    }
+    s_scanning = true;
+    pthread_mutex_unlock(&s_wifi_mutex);
+    __atomic_add_fetch(&shim_wifi.scans, 1, __ATOMIC_SEQ_CST);
+    vTaskDelay(pdMS_TO_TICKS(shim_wifi.scan_ms));
+    pthread_mutex_lock(&s_wifi_mutex);
+    s_scanning = false;
+    pthread_mutex_unlock(&s_wifi_mutex);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number)
+{
+    *number = shim_wifi.scan_record_count;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *ap_records)
+{
+    uint16_t n = (*number < shim_wifi.scan_record_count) ? *number : shim_wifi.scan_record_count;
+    memcpy(ap_records, shim_wifi.scan_records, n * sizeof(wifi_ap_record_t));
+    *number = n;
+    return ESP_OK;
+}
@@ -0,0 +1,313 @@
+// Host shim of FreeRTOS tasks and semaphores on POSIX threads
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "shim.h"
+
+uint64_t shim_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void deadline_after(struct timespec *ts, uint32_t ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static void cond_init_monotonic(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// MARK: semaphores
+struct shim_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    UBaseType_t     count;
+    UBaseType_t     max_count;
+};
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    SemaphoreHandle_t semph = calloc(1, sizeof(*semph));
+    if (semph == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_init(&semph->mutex, NULL);
+    cond_init_monotonic(&semph->cond);
+    semph->count = initial_count;
+    semph->max_count = max_count;
+    return semph;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semph, TickType_t ticks_to_wait)
+{
+    struct timespec deadline;
+    deadline_after(&deadline, pdTICKS_TO_MS(ticks_to_wait));
+    pthread_mutex_lock(&semph->mutex);
+    while (semph->count == 0)
+    {
+        if (ticks_to_wait == portMAX_DELAY)
+        {
+            pthread_cond_wait(&semph->cond, &semph->mutex);
+        } else if (ticks_to_wait == 0 || pthread_cond_timedwait(&semph->cond, &semph->mutex, &deadline) == ETIMEDOUT) {
+            if (semph->count == 0)
+            {
+                pthread_mutex_unlock(&semph->mutex);
+                return pdFALSE;
+            }
+        }
+    }
+    semph->count--;
+    pthread_mutex_unlock(&semph->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semph)
+{
+    BaseType_t ret = pdFALSE;
+    pthread_mutex_lock(&semph->mutex);
+    if (semph->count < semph->max_count)
+    {
+        semph->count++;
+        ret = pdTRUE;
+        pthread_cond_signal(&semph->cond);
+    }
+    pthread_mutex_unlock(&semph->mutex);
+    return ret;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semph)
+{
+    if (semph == NULL)
+    {
+        return;
+    }
+    pthread_cond_destroy(&semph->cond);
+    pthread_mutex_destroy(&semph->mutex);
+    free(semph);
+}
+
+// MARK: tasks
+#define SHIM_MAX_TASK_NAMES 64
+
+struct shim_task {
+    pthread_t      thread;
+    TaskFunction_t fn;
+    void          *param;
+    int            name_index;
+};
+
+static struct {
+    char name[32];
+    int  created;
+    int  running;
+} s_task_names[SHIM_MAX_TASK_NAMES];
+static pthread_mutex_t s_task_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  s_task_cond;
+static pthread_once_t  s_task_once = PTHREAD_ONCE_INIT;
+static __thread struct shim_task *s_current_task = NULL;
+
+static void task_init_once(void)
+{
+    cond_init_monotonic(&s_task_cond);
+}
+
+static int task_name_index(const char *name)
+{
+    for (int i = 0; i < SHIM_MAX_TASK_NAMES; i++)
+    {
+        if (s_task_names[i].name[0] == '\0')
+        {
+            strncpy(s_task_names[i].name, name, sizeof(s_task_names[i].name) - 1);
+            return i;
+        }
+        if (strcmp(s_task_names[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    abort(); // Too many task names for the shim
+}
+
+static void task_exit(void *arg)
+{
+    struct shim_task *task = arg;
+    pthread_mutex_lock(&s_task_mutex);
+    s_task_names[task->name_index].running--;
+    pthread_cond_broadcast(&s_task_cond);
+    pthread_mutex_unlock(&s_task_mutex);
+    free(task);
+}
+
+static void *task_entry(void *arg)
+{
+    struct shim_task *task = arg;
+    s_current_task = task;
+    pthread_cleanup_push(task_exit, task);
+    task->fn(task->param);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created_task)
+{
+    pthread_once(&s_task_once, task_init_once);
+    struct shim_task *task = calloc(1, sizeof(*task));
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->param = param;
+    pthread_mutex_lock(&s_task_mutex);
+    task->name_index = task_name_index(name);
+    s_task_names[task->name_index].created++;
+    s_task_names[task->name_index].running++;
+    pthread_mutex_unlock(&s_task_mutex);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0)
+    {
+        pthread_mutex_lock(&s_task_mutex);
+        s_task_names[task->name_index].running--;
+        pthread_mutex_unlock(&s_task_mutex);
+        free(task);
+        return pdFAIL;
+    }
+    if (created_task != NULL)
+    {
+        *created_task = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_current_task)
+    {
+        pthread_exit(NULL);
+    }
+    abort(); // Deleting other tasks is not supported by the shim
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    const uint32_t ms = pdTICKS_TO_MS(ticks);
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+    if (task != NULL && task != s_current_task)
+    {
+        abort(); // Suspending other tasks is not supported by the shim
+    }
+    for (;;)
+    {
+        pause();
+    }
+}
+
+static uint64_t s_start_us;
+
+__attribute__((constructor)) static void tick_init(void)
+{
+    s_start_us = shim_time_us();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)((shim_time_us() - s_start_us) / 1000);
+}
+
+static int task_stat(const char *name, bool running)
+{
+    int n = 0;
+    pthread_mutex_lock(&s_task_mutex);
+    for (int i = 0; i < SHIM_MAX_TASK_NAMES && s_task_names[i].name[0] != '\0'; i++)
+    {
+        if (strcmp(s_task_names[i].name, name) == 0)
+        {
+            n = running ? s_task_names[i].running : s_task_names[i].created;
+        }
+    }
+    pthread_mutex_unlock(&s_task_mutex);
+    return n;
+}
+
+int shim_task_created(const char *name)
+{
+    return task_stat(name, false);
+}
+
+int shim_task_running(const char *name)
+{
+    return task_stat(name, true);
+}
+
+bool shim_task_wait_idle(const char *name, uint32_t timeout_ms)
+{
+    pthread_once(&s_task_once, task_init_once);
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+    pthread_mutex_lock(&s_task_mutex);
+    for (;;)
+    {
+        int running = 0;
+        for (int i = 0; i < SHIM_MAX_TASK_NAMES && s_task_names[i].name[0] != '\0'; i++)
+        {
+            if (strcmp(s_task_names[i].name, name) == 0)
+            {
+                running = s_task_names[i].running;
+            }
+        }
+        if (running == 0)
+        {
+            pthread_mutex_unlock(&s_task_mutex);
+            return true;
+        }
+        if (pthread_cond_timedwait(&s_task_cond, &s_task_mutex, &deadline) == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&s_task_mutex);
+            return false;
+        }
+    }
+}
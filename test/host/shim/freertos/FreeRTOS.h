@@ -0,0 +1,32 @@
+// Host shim of FreeRTOS on POSIX threads. One tick is one millisecond.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h> // Like FreeRTOSConfig.h on ESP-IDF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t)    ((uint32_t)(t))
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "freertos/semphr.h"
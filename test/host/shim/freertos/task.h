@@ -0,0 +1,24 @@
+// Host shim of FreeRTOS tasks. Each task is a detached POSIX thread, priority and stack size are ignored.
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct shim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0)
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created_task);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskSuspend(TaskHandle_t task);
+TickType_t xTaskGetTickCount(void);
+
+#ifdef __cplusplus
+}
+#endif
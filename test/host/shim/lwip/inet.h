@@ -0,0 +1,18 @@
+// Host shim of lwIP inet.h, only helpers used with esp_netif addresses
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    ((ipaddr)->addr = (uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+char *shim_ip4addr_ntoa_r(const uint32_t *addr, char *buf, int buflen);
+#define inet_ntoa_r(addr, buf, buflen) shim_ip4addr_ntoa_r((const uint32_t *)&(addr), buf, buflen)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,199 @@
+// Host shim of mbedtls SHA-256 (FIPS 180-4) and base64 encoder
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/constant_time.h"
+
+// MARK: sha256
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(mbedtls_sha256_context *ctx, const unsigned char *p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        const uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        const uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        const uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+    ctx->state[5] += f;
+    ctx->state[6] += g;
+    ctx->state[7] += h;
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    if (is224)
+    {
+        return -1; // SHA-224 not needed by the component
+    }
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->total[0] = ctx->total[1] = 0;
+    ctx->is224 = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    size_t fill = ctx->total[0] & 0x3F;
+    const uint32_t low = ctx->total[0];
+    ctx->total[0] += (uint32_t)ilen;
+    if (ctx->total[0] < low)
+    {
+        ctx->total[1]++;
+    }
+    ctx->total[1] += (uint32_t)((uint64_t)ilen >> 32);
+    while (ilen > 0)
+    {
+        size_t n = 64 - fill;
+        if (n > ilen)
+        {
+            n = ilen;
+        }
+        memcpy(ctx->buffer + fill, input, n);
+        fill += n;
+        input += n;
+        ilen -= n;
+        if (fill == 64)
+        {
+            sha256_block(ctx, ctx->buffer);
+            fill = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output)
+{
+    const uint64_t bits = ((uint64_t)ctx->total[1] << 32 | ctx->total[0]) * 8;
+    size_t fill = ctx->total[0] & 0x3F;
+    ctx->buffer[fill++] = 0x80;
+    if (fill > 56)
+    {
+        memset(ctx->buffer + fill, 0, 64 - fill);
+        sha256_block(ctx, ctx->buffer);
+        fill = 0;
+    }
+    memset(ctx->buffer + fill, 0, 56 - fill);
+    for (int i = 0; i < 8; i++)
+    {
+        ctx->buffer[56 + i] = (unsigned char)(bits >> (56 - i * 8));
+    }
+    sha256_block(ctx, ctx->buffer);
+    for (int i = 0; i < 8; i++)
+    {
+        output[i * 4]     = (unsigned char)(ctx->state[i] >> 24);
+        output[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        output[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        output[i * 4 + 3] = (unsigned char)(ctx->state[i]);
+    }
+    return 0;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int is224)
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    int ret = mbedtls_sha256_starts(&ctx, is224);
+    if (ret == 0)
+    {
+        mbedtls_sha256_update(&ctx, input, ilen);
+        mbedtls_sha256_finish(&ctx, output);
+    }
+    mbedtls_sha256_free(&ctx);
+    return ret;
+}
+
+// MARK: base64
+// Same contract as mbedtls: *olen is required buffer size including NUL on BUFFER_TOO_SMALL,
+// written length without NUL on success.
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const size_t n = (slen + 2) / 3 * 4;
+    if (slen == 0)
+    {
+        *olen = 0;
+        return 0;
+    }
+    if (dst == NULL || dlen < n + 1)
+    {
+        *olen = n + 1;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    unsigned char *p = dst;
+    for (size_t i = 0; i < slen; i += 3)
+    {
+        const uint32_t v = (uint32_t)src[i] << 16 | (i + 1 < slen ? (uint32_t)src[i + 1] << 8 : 0) |
+                           (i + 2 < slen ? src[i + 2] : 0);
+        *p++ = alphabet[(v >> 18) & 0x3F];
+        *p++ = alphabet[(v >> 12) & 0x3F];
+        *p++ = (i + 1 < slen) ? alphabet[(v >> 6) & 0x3F] : '=';
+        *p++ = (i + 2 < slen) ? alphabet[v & 0x3F] : '=';
+    }
+    *p = '\0';
+    *olen = n;
+    return 0;
+}
+
+// MARK: constant time
+// Same contract as mbedtls: 0 if equal, run time depends on n only.
+int mbedtls_ct_memcmp(const void *a, const void *b, size_t n)
+{
+    const volatile unsigned char *pa = a;
+    const volatile unsigned char *pb = b;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        diff |= pa[i] ^ pb[i];
+    }
+    return diff;
+}
@@ -0,0 +1,14 @@
+// Host shim of mbedtls/constant_time.h
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int mbedtls_ct_memcmp(const void *a, const void *b, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
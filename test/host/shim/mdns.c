@@ -0,0 +1,93 @@
+// Host shim of espressif/mdns service registry and captive portal DNS server
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "mdns.h"
+#include "dns_server.h"
+#include "shim.h"
+
+#define SHIM_MDNS_MAX_SERVICES 8
+
+static pthread_mutex_t     s_mdns_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool                s_mdns_init = false;
+static shim_mdns_service_t s_services[SHIM_MDNS_MAX_SERVICES];
+static int                 s_service_count = 0;
+
+esp_err_t mdns_init(void)
+{
+    pthread_mutex_lock(&s_mdns_mutex);
+    esp_err_t err = s_mdns_init ? ESP_ERR_INVALID_STATE : ESP_OK;
+    s_mdns_init = true;
+    pthread_mutex_unlock(&s_mdns_mutex);
+    return err;
+}
+
+void mdns_free(void)
+{
+    pthread_mutex_lock(&s_mdns_mutex);
+    s_mdns_init = false;
+    s_service_count = 0;
+    pthread_mutex_unlock(&s_mdns_mutex);
+}
+
+esp_err_t mdns_hostname_set(const char *hostname)
+{
+    return s_mdns_init ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t mdns_service_add(const char *instance_name, const char *service_type, const char *proto,
+                           uint16_t port, mdns_txt_item_t txt[], size_t num_items)
+{
+    pthread_mutex_lock(&s_mdns_mutex);
+    esp_err_t err = ESP_OK;
+    if (!s_mdns_init)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    } else if (s_service_count >= SHIM_MDNS_MAX_SERVICES) {
+        err = ESP_ERR_NO_MEM;
+    } else {
+        shim_mdns_service_t *service = &s_services[s_service_count++];
+        memset(service, 0, sizeof(*service));
+        snprintf(service->instance, sizeof(service->instance), "%s", instance_name != NULL ? instance_name : "");
+        snprintf(service->type, sizeof(service->type), "%s", service_type);
+        snprintf(service->proto, sizeof(service->proto), "%s", proto);
+        service->port = port;
+        size_t len = 0;
+        for (size_t i = 0; i < num_items && len < sizeof(service->txt); i++)
+        {
+            len += snprintf(service->txt + len, sizeof(service->txt) - len, "%s%s=%s", (i > 0) ? ";" : "",
+                            txt[i].key, txt[i].value);
+        }
+    }
+    pthread_mutex_unlock(&s_mdns_mutex);
+    return err;
+}
+
+int shim_mdns_service_count(void)
+{
+    pthread_mutex_lock(&s_mdns_mutex);
+    int count = s_service_count;
+    pthread_mutex_unlock(&s_mdns_mutex);
+    return count;
+}
+
+const shim_mdns_service_t *shim_mdns_service(int index)
+{
+    return (index >= 0 && index < shim_mdns_service_count()) ? &s_services[index] : NULL;
+}
+
+// MARK: dns_server
+struct dns_server_handle {
+    int started;
+};
+
+dns_server_handle_t start_dns_server(dns_server_config_t *config)
+{
+    static struct dns_server_handle handle;
+    handle.started++;
+    return &handle;
+}
+
+void stop_dns_server(dns_server_handle_t handle)
+{
+}
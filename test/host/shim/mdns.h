@@ -0,0 +1,25 @@
+// Host shim of espressif/mdns mdns.h. Services are recorded, see shim.h.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *key;
+    const char *value;
+} mdns_txt_item_t;
+
+esp_err_t mdns_init(void);
+void mdns_free(void);
+esp_err_t mdns_hostname_set(const char *hostname);
+esp_err_t mdns_service_add(const char *instance_name, const char *service_type, const char *proto,
+                           uint16_t port, mdns_txt_item_t txt[], size_t num_items);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,415 @@
+// Host shim of NVS default partition. Entries live in RAM and are saved to backing file on every change,
+// so nvs_flash_deinit() + nvs_flash_init() simulates reboot.
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "shim.h"
+
+#define SHIM_NVS_MAX_ENTRIES    128
+#define SHIM_NVS_MAX_NAMESPACES 16
+#define SHIM_NVS_MAX_HANDLES    32
+#define SHIM_NVS_MAX_DATA       512
+
+typedef struct {
+    bool       used;
+    char       ns[NVS_KEY_NAME_MAX_SIZE];
+    char       key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    uint32_t   len;
+    uint8_t    data[SHIM_NVS_MAX_DATA];
+} nvs_entry_t;
+
+typedef struct {
+    bool            used;
+    char            ns[NVS_KEY_NAME_MAX_SIZE];
+    nvs_open_mode_t mode;
+} nvs_open_handle_t;
+
+static pthread_mutex_t   s_nvs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool              s_nvs_init = false;
+static char              s_nvs_path[256] = "";
+static nvs_entry_t       s_entries[SHIM_NVS_MAX_ENTRIES];
+static char              s_namespaces[SHIM_NVS_MAX_NAMESPACES][NVS_KEY_NAME_MAX_SIZE];
+static nvs_open_handle_t s_handles[SHIM_NVS_MAX_HANDLES];
+static shim_nvs_wear_t   s_wear;
+
+// MARK: backing file
+// Record: namespace, key, type, length, data. Namespace without key records empty namespace.
+static void nvs_save(void)
+{
+    if (s_nvs_path[0] == '\0')
+    {
+        return;
+    }
+    FILE *f = fopen(s_nvs_path, "wb");
+    if (f == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < SHIM_NVS_MAX_NAMESPACES; i++)
+    {
+        if (s_namespaces[i][0] != '\0')
+        {
+            nvs_entry_t ns = { .used = true, .type = NVS_TYPE_ANY };
+            memcpy(ns.ns, s_namespaces[i], sizeof(ns.ns));
+            fwrite(&ns, sizeof(ns), 1, f);
+        }
+    }
+    for (int i = 0; i < SHIM_NVS_MAX_ENTRIES; i++)
+    {
+        if (s_entries[i].used)
+        {
+            fwrite(&s_entries[i], sizeof(s_entries[i]), 1, f);
+        }
+    }
+    fclose(f);
+}
+
+static void nvs_load(void)
+{
+    memset(s_entries, 0, sizeof(s_entries));
+    memset(s_namespaces, 0, sizeof(s_namespaces));
+    FILE *f = (s_nvs_path[0] != '\0') ? fopen(s_nvs_path, "rb") : NULL;
+    if (f == NULL)
+    {
+        return;
+    }
+    nvs_entry_t entry;
+    int ns_count = 0;
+    int entry_count = 0;
+    while (fread(&entry, sizeof(entry), 1, f) == 1)
+    {
+        if (entry.type == NVS_TYPE_ANY && ns_count < SHIM_NVS_MAX_NAMESPACES)
+        {
+            memcpy(s_namespaces[ns_count++], entry.ns, NVS_KEY_NAME_MAX_SIZE);
+        } else if (entry.type != NVS_TYPE_ANY && entry_count < SHIM_NVS_MAX_ENTRIES) {
+            s_entries[entry_count++] = entry;
+        }
+    }
+    fclose(f);
+}
+
+void shim_nvs_set_path(const char *path)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    snprintf(s_nvs_path, sizeof(s_nvs_path), "%s", path != NULL ? path : "");
+    pthread_mutex_unlock(&s_nvs_mutex);
+}
+
+shim_nvs_wear_t shim_nvs_wear(void)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    shim_nvs_wear_t wear = s_wear;
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return wear;
+}
+
+// MARK: nvs_flash
+esp_err_t nvs_flash_init(void)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    if (!s_nvs_init)
+    {
+        nvs_load();
+        memset(s_handles, 0, sizeof(s_handles));
+        s_nvs_init = true;
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_deinit(void)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    esp_err_t err = s_nvs_init ? ESP_OK : ESP_ERR_NVS_NOT_INITIALIZED;
+    s_nvs_init = false;
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    memset(s_entries, 0, sizeof(s_entries));
+    memset(s_namespaces, 0, sizeof(s_namespaces));
+    s_wear.partition_erases++;
+    nvs_save();
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return ESP_OK;
+}
+
+// MARK: nvs
+static bool namespace_exists(const char *ns)
+{
+    for (int i = 0; i < SHIM_NVS_MAX_NAMESPACES; i++)
+    {
+        if (strcmp(s_namespaces[i], ns) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t namespace_create(const char *ns)
+{
+    for (int i = 0; i < SHIM_NVS_MAX_NAMESPACES; i++)
+    {
+        if (s_namespaces[i][0] == '\0')
+        {
+            strcpy(s_namespaces[i], ns);
+            s_wear.entry_writes++; // Namespace index entry
+            nvs_save();
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (namespace_name == NULL || strlen(namespace_name) == 0 || strlen(namespace_name) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    pthread_mutex_lock(&s_nvs_mutex);
+    esp_err_t err = ESP_OK;
+    if (!s_nvs_init)
+    {
+        err = ESP_ERR_NVS_NOT_INITIALIZED;
+    } else if (!namespace_exists(namespace_name)) {
+        err = (open_mode == NVS_READWRITE) ? namespace_create(namespace_name) : ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (err == ESP_OK)
+    {
+        err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        for (int i = 0; i < SHIM_NVS_MAX_HANDLES; i++)
+        {
+            if (!s_handles[i].used)
+            {
+                s_handles[i].used = true;
+                s_handles[i].mode = open_mode;
+                strcpy(s_handles[i].ns, namespace_name);
+                *out_handle = i + 1;
+                err = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    if (handle >= 1 && handle <= SHIM_NVS_MAX_HANDLES)
+    {
+        s_handles[handle - 1].used = false;
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+}
+
+// Called with mutex held
+static nvs_open_handle_t *handle_get(nvs_handle_t handle)
+{
+    if (!s_nvs_init || handle < 1 || handle > SHIM_NVS_MAX_HANDLES || !s_handles[handle - 1].used)
+    {
+        return NULL;
+    }
+    return &s_handles[handle - 1];
+}
+
+static nvs_entry_t *entry_find(const char *ns, const char *key)
+{
+    for (int i = 0; i < SHIM_NVS_MAX_ENTRIES; i++)
+    {
+        if (s_entries[i].used && strcmp(s_entries[i].ns, ns) == 0 && strcmp(s_entries[i].key, key) == 0)
+        {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    esp_err_t err = (handle_get(handle) != NULL) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+    if (err == ESP_OK)
+    {
+        s_wear.commits++;
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err = ESP_OK;
+    if (h == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (h->mode == NVS_READONLY) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        nvs_entry_t *entry = entry_find(h->ns, key);
+        if (entry == NULL)
+        {
+            err = ESP_ERR_NVS_NOT_FOUND;
+        } else {
+            entry->used = false;
+            s_wear.entry_erases++;
+            nvs_save();
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err = ESP_OK;
+    if (h == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (h->mode == NVS_READONLY) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        for (int i = 0; i < SHIM_NVS_MAX_ENTRIES; i++)
+        {
+            if (s_entries[i].used && strcmp(s_entries[i].ns, h->ns) == 0)
+            {
+                s_entries[i].used = false;
+                s_wear.entry_erases++;
+            }
+        }
+        nvs_save();
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, nvs_type_t type, const void *data, size_t len)
+{
+    if (key == NULL || strlen(key) == 0)
+    {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+    {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (len > SHIM_NVS_MAX_DATA)
+    {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    pthread_mutex_lock(&s_nvs_mutex);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err = ESP_OK;
+    if (h == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (h->mode == NVS_READONLY) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        nvs_entry_t *entry = entry_find(h->ns, key);
+        for (int i = 0; entry == NULL && i < SHIM_NVS_MAX_ENTRIES; i++)
+        {
+            if (!s_entries[i].used)
+            {
+                entry = &s_entries[i];
+            }
+        }
+        if (entry == NULL)
+        {
+            err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        } else {
+            entry->used = true;
+            strcpy(entry->ns, h->ns);
+            strcpy(entry->key, key);
+            entry->type = type;
+            entry->len = len;
+            memcpy(entry->data, data, len);
+            s_wear.entry_writes++;
+            nvs_save();
+        }
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+// *len is buffer size on input and stored length on output. Buffer NULL queries length.
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, nvs_type_t type, void *data, size_t *len)
+{
+    pthread_mutex_lock(&s_nvs_mutex);
+    nvs_open_handle_t *h = handle_get(handle);
+    nvs_entry_t *entry = (h != NULL) ? entry_find(h->ns, key) : NULL;
+    esp_err_t err = ESP_OK;
+    if (h == NULL)
+    {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (entry == NULL) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (entry->type != type) {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (data == NULL) {
+        *len = entry->len;
+    } else if (*len < entry->len) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(data, entry->data, entry->len);
+        *len = entry->len;
+    }
+    pthread_mutex_unlock(&s_nvs_mutex);
+    return err;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return nvs_set(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    size_t len = sizeof(*out_value);
+    return nvs_get(handle, key, NVS_TYPE_U8, out_value, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t len = sizeof(*out_value);
+    return nvs_get(handle, key, NVS_TYPE_U32, out_value, &len);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return nvs_set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return nvs_get(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
@@ -0,0 +1,12 @@
+// Host build configuration. Mirrors options a firmware project sets in sdkconfig.
+#pragma once
+
+#define CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE 1
+#ifndef CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT // Tests may shorten deadline
+#define CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT 120
+#endif
+#define CONFIG_WIFI_PROVISION_CARE_MAINTENANCE 1
+#define CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_USER "admin"
+#define CONFIG_WIFI_PROVISION_CARE_MAINTENANCE_PASSWORD "secret"
+#define CONFIG_HTTPD_MAX_REQ_HDR_LEN 1024
+#define CONFIG_LWIP_MAX_SOCKETS 16
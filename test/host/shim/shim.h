@@ -0,0 +1,121 @@
+// Host shim control API. Tests use it to configure simulated hardware and inspect what the component did.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "esp_ota_ops.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// MARK: FreeRTOS
+// Number of tasks created with given name since start, and number of them still running.
+int shim_task_created(const char *name);
+int shim_task_running(const char *name);
+// Wait until no task with given name is running. Returns false on timeout.
+bool shim_task_wait_idle(const char *name, uint32_t timeout_ms);
+
+// MARK: esp_system
+int shim_restart_count(void);
+// Wait until esp_restart() called at least count times. Returns false on timeout.
+bool shim_restart_wait(int count, uint32_t timeout_ms);
+
+// MARK: esp_wifi
+#define SHIM_WIFI_MAX_SCAN 20
+typedef struct {
+    // Configuration
+    bool             connect_ok;            // esp_wifi_connect() gets IP, otherwise disconnects
+    int              connect_fail_count;    // Number of first esp_wifi_connect() calls to fail anyway
+    uint32_t         scan_ms;               // Blocking scan duration
+    uint32_t         flash_write_ms;        // esp_wifi_set_config() duration with WIFI_STORAGE_FLASH
+    wifi_ap_record_t scan_records[SHIM_WIFI_MAX_SCAN];
+    uint16_t         scan_record_count;
+    // Statistics
+    int              connect_calls;
+    int              scans;
+    int              config_flash_writes;   // esp_wifi_set_config() calls persisted to NVS
+    int              restores;
+} shim_wifi_t;
+extern shim_wifi_t shim_wifi;
+
+// MARK: esp_ota_ops
+typedef struct {
+    // Configuration
+    bool     no_update_partition;    // esp_ota_get_next_update_partition() returns NULL
+    uint32_t write_us_per_kib;       // Simulated flash write time
+    // State and statistics
+    int      mark_valid_calls;
+    int      rollback_calls;
+} shim_ota_t;
+extern shim_ota_t shim_ota;
+void shim_ota_reset(void);
+void shim_ota_set_state(const esp_partition_t *partition, esp_ota_img_states_t state);
+// Image written to partition by last successful esp_ota_end()
+const uint8_t *shim_ota_image(const esp_partition_t *partition, size_t *size);
+
+// MARK: nvs
+// Every nvs_set_*() call and every erased entry counts as one flash entry write. NVS wears a page by
+// appending entries, so the counter is a worst case wear model independent of NVS page layout.
+typedef struct {
+    uint32_t entry_writes;
+    uint32_t entry_erases;
+    uint32_t partition_erases;
+    uint32_t commits;
+} shim_nvs_wear_t;
+// Backing file of default NVS partition. Must be set before nvs_flash_init().
+void shim_nvs_set_path(const char *path);
+shim_nvs_wear_t shim_nvs_wear(void);
+
+// MARK: esp_http_server
+typedef struct shim_httpd_exchange {
+    // Request
+    const char    *query;          // URL query without '?', NULL if none
+    const char    *authorization;  // "Authorization" header value, NULL if none
+    const char    *requested_with; // "X-Requested-With" header value, NULL if none
+    const char    *body;
+    size_t         body_len;
+    size_t         recv_chunk;     // Max bytes returned by one httpd_req_recv(), 0 - unlimited
+    // Response
+    char           status[48];
+    char           content_type[48];
+    char           location[128];
+    char           www_authenticate[128];
+    char          *resp;
+    size_t         resp_len;
+    bool           async;          // Handler moved request to httpd_req_async_handler_begin()
+    bool           done;
+    void          *priv;
+} shim_httpd_exchange_t;
+
+// Run URI handler for request on caller thread, as httpd task does. Returns handler result.
+esp_err_t shim_httpd_request(httpd_handle_t server, httpd_method_t method, const char *uri, shim_httpd_exchange_t *ex);
+// Wait until response completed, async requests included. Returns false on timeout.
+bool shim_httpd_wait(shim_httpd_exchange_t *ex, uint32_t timeout_ms);
+void shim_httpd_exchange_free(shim_httpd_exchange_t *ex);
+int shim_httpd_handler_count(httpd_handle_t server);
+
+// MARK: esp_http_client
+int shim_http_client_connects(void);
+
+// MARK: mdns
+typedef struct {
+    char     instance[64];
+    char     type[32];
+    char     proto[16];
+    uint16_t port;
+    char     txt[128];   // "key=value;key=value"
+} shim_mdns_service_t;
+int shim_mdns_service_count(void);
+const shim_mdns_service_t *shim_mdns_service(int index);
+
+// MARK: time
+uint64_t shim_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
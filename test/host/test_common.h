@@ -0,0 +1,107 @@
+// Minimal test harness for host tests. Every test runs in a forked child, so component statics and
+// shim state start fresh, as after device reset.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "nvs_flash.h"
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_http_server.h"
+#include "shim.h"
+
+#define TEST_ASSERT(cond) do {                                                          \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_INT(expected, actual) do {                                    \
+        long long e_ = (expected), a_ = (actual);                                       \
+        if (e_ != a_) {                                                                 \
+            fprintf(stderr, "%s:%d: %s expected %lld, got %lld\n", __FILE__, __LINE__,  \
+                    #actual, e_, a_);                                                   \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual) do {                                 \
+        const char *e_ = (expected), *a_ = (actual);                                    \
+        if (a_ == NULL || strcmp(e_, a_) != 0) {                                        \
+            fprintf(stderr, "%s:%d: %s expected \"%s\", got \"%s\"\n", __FILE__,        \
+                    __LINE__, #actual, e_, a_ != NULL ? a_ : "(null)");                 \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+static int s_test_failures = 0;
+
+static inline void test_run(void (*fn)(void), const char *name)
+{
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        fn();
+        fflush(stdout);
+        exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    const int ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+    s_test_failures += !ok;
+}
+
+#define RUN_TEST(fn) test_run(fn, #fn)
+#define TEST_EXIT()  return (s_test_failures == 0) ? 0 : 1
+
+// MARK: fixtures
+// Empty NVS file backing default partition, as after flash erase, and NVS initialized.
+static inline void wpc_fresh_nvs(const char *path)
+{
+    unlink(path);
+    shim_nvs_set_path(path);
+    TEST_ASSERT(nvs_flash_init() == ESP_OK);
+}
+
+// Fresh NVS and Wi-Fi driver initialized.
+static inline void wpc_fresh_wifi(const char *nvs_path)
+{
+    wpc_fresh_nvs(nvs_path);
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    TEST_ASSERT(esp_wifi_init(&cfg) == ESP_OK);
+}
+
+// Fresh NVS, Wi-Fi driver initialized, http server with provisioning handlers as in SoftAP mode.
+// Needs component source included before this header.
+static inline httpd_handle_t wpc_handlers_setup(const char *nvs_path)
+{
+    wpc_fresh_wifi(nvs_path);
+    esp_netif_t *ap_netif = esp_netif_create_default_wifi_ap();
+    esp_netif_ip_info_t ip_info = { 0 };
+    IP4_ADDR(&ip_info.ip, 200, 200, 200, 2);
+    esp_netif_set_ip_info(ap_netif, &ip_info);
+    httpd_handle_t server = start_webserver();
+    TEST_ASSERT(server != NULL);
+    return server;
+}
+
+// Firmware image accepted by app_update shim, first byte is image header magic.
+static inline uint8_t *make_image(size_t size)
+{
+    uint8_t *image = malloc(size);
+    TEST_ASSERT(image != NULL);
+    for (size_t i = 0; i < size; i++)
+    {
+        image[i] = (uint8_t)(i * 7 + 3);
+    }
+    image[0] = 0xE9; // ESP_IMAGE_HEADER_MAGIC
+    return image;
+}
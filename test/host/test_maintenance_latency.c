@@ -0,0 +1,274 @@
+// Host tests of maintenance portal on application http server: authentication, cross-site request refusal,
+// single request in flight, and latency budget of application handlers while Wi-Fi scan and settings save run.
+#include "esp32-wifi-provision-care.c"
+#include <pthread.h>
+#include "shim.h"
+#include "test_common.h"
+
+#define NVS_FILE         "test_maintenance_latency.nvs"
+#define AUTH_OK          "Basic YWRtaW46c2VjcmV0"  // admin:secret
+#define AUTH_WRONG       "Basic YWRtaW46c2VjcmVU"  // admin:secreT, same length
+#define FETCH            "XMLHttpRequest"          // X-Requested-With of portal page fetch()
+#define APP_BUDGET_US    (20 * 1000)               // Application request latency budget
+#define APP_CLIENTS      2
+#define APP_MAX_SAMPLES  4096
+
+// Single httpd task on target runs one handler at a time. Clients take it around shim_httpd_request().
+static pthread_mutex_t s_httpd_task = PTHREAD_MUTEX_INITIALIZER;
+
+static esp_err_t httpd_task_request(httpd_handle_t server, const char *uri, shim_httpd_exchange_t *ex)
+{
+    pthread_mutex_lock(&s_httpd_task);
+    esp_err_t err = shim_httpd_request(server, HTTP_GET, uri, ex);
+    pthread_mutex_unlock(&s_httpd_task);
+    return err;
+}
+
+// Application handler, short JSON status
+static esp_err_t app_status_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, "{\"status\":\"ok\"}", HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Application server in STA mode with application handler and maintenance portal
+static httpd_handle_t app_server_setup(uint16_t max_uri_handlers)
+{
+    wpc_fresh_wifi(NVS_FILE);
+    TEST_ASSERT(esp_wifi_set_mode(WIFI_MODE_STA) == ESP_OK);
+    shim_wifi.scan_record_count = 15;
+    for (int i = 0; i < shim_wifi.scan_record_count; i++)
+    {
+        snprintf((char *)shim_wifi.scan_records[i].ssid, sizeof(shim_wifi.scan_records[i].ssid), "AccessPoint-%02d", i);
+        shim_wifi.scan_records[i].rssi = -30 - i;
+    }
+    TEST_ASSERT(mdns_init() == ESP_OK);
+
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = max_uri_handlers;
+    TEST_ASSERT(httpd_start(&server, &config) == ESP_OK);
+    const httpd_uri_t status_uri = { .uri = "/api/status", .method = HTTP_GET, .handler = app_status_handler };
+    TEST_ASSERT(httpd_register_uri_handler(server, &status_uri) == ESP_OK);
+    return server;
+}
+
+// MARK: portal tests
+static void test_register_error_returned(void)
+{
+    httpd_handle_t server = app_server_setup(1 + 3); // Room for 3 of 5 portal handlers
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_HTTPD_HANDLERS_FULL, wifi_provision_care_maintenance_start(server, 80));
+    TEST_ASSERT_EQUAL_INT(0, shim_mdns_service_count());
+    TEST_ASSERT_EQUAL_INT(1, shim_httpd_handler_count(server)); // Application handler only
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_HTTPD_HANDLERS_FULL, wifi_provision_care_maintenance_start(server, 80)); // Not HANDLER_EXISTS
+    TEST_ASSERT_EQUAL_INT(1, shim_httpd_handler_count(server));
+}
+
+static void test_authentication(void)
+{
+    httpd_handle_t server = app_server_setup(1 + 5);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_maintenance_start(server, 80));
+    TEST_ASSERT_EQUAL_INT(1, shim_mdns_service_count());
+
+    const char *uris[] = { "/wifi", "/scanap", "/savewifi", "/nvserase", "/favicon.ico" };
+    const char *auths[] = { NULL, AUTH_WRONG, "Basic", AUTH_OK "x" };
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++)
+    {
+        for (int j = 0; j < sizeof(auths) / sizeof(auths[0]); j++)
+        {
+            shim_httpd_exchange_t ex = { .authorization = auths[j], .requested_with = FETCH,
+                                         .query = "ssid=HomeAP&password=password123" };
+            TEST_ASSERT(httpd_task_request(server, uris[i], &ex) == ESP_OK);
+            TEST_ASSERT(shim_httpd_wait(&ex, 1000));
+            TEST_ASSERT_EQUAL_STRING("401 Unauthorized", ex.status);
+            TEST_ASSERT(strstr(ex.www_authenticate, "Basic realm=") == ex.www_authenticate);
+            shim_httpd_exchange_free(&ex);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.scans);
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.config_flash_writes);
+
+    shim_httpd_exchange_t ex = { .authorization = AUTH_OK };
+    TEST_ASSERT(httpd_task_request(server, "/wifi", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("200 OK", ex.status);
+    shim_httpd_exchange_free(&ex);
+}
+
+static void test_cross_site_request_refused(void)
+{
+    httpd_handle_t server = app_server_setup(1 + 5);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_maintenance_start(server, 80));
+
+    // Authenticated browser loads <img src> from other site, no custom header without CORS preflight
+    const char *uris[] = { "/scanap", "/savewifi", "/nvserase" };
+    const char *requested_withs[] = { NULL, "", "XMLHttpRequestX", "fetch" };
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++)
+    {
+        for (int j = 0; j < sizeof(requested_withs) / sizeof(requested_withs[0]); j++)
+        {
+            shim_httpd_exchange_t ex = { .authorization = AUTH_OK, .requested_with = requested_withs[j],
+                                         .query = "ssid=HomeAP&password=password123" };
+            TEST_ASSERT(httpd_task_request(server, uris[i], &ex) == ESP_OK);
+            TEST_ASSERT(!ex.async);
+            TEST_ASSERT_EQUAL_STRING("403 Forbidden", ex.status);
+            shim_httpd_exchange_free(&ex);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.scans);
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.config_flash_writes);
+    TEST_ASSERT_EQUAL_INT(0, shim_task_created("nvserase"));
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.restores);
+
+    // Page itself is loaded by navigation
+    shim_httpd_exchange_t ex = { .authorization = AUTH_OK };
+    TEST_ASSERT(httpd_task_request(server, "/wifi", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("200 OK", ex.status);
+    shim_httpd_exchange_free(&ex);
+
+    // Portal page fetch() resets settings
+    ex = (shim_httpd_exchange_t){ .authorization = AUTH_OK, .requested_with = FETCH };
+    TEST_ASSERT(httpd_task_request(server, "/nvserase", &ex) == ESP_OK);
+    TEST_ASSERT(shim_httpd_wait(&ex, 1000));
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT(shim_task_wait_idle("nvserase", 5000));
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.restores);
+}
+
+static void test_single_request_in_flight(void)
+{
+    httpd_handle_t server = app_server_setup(1 + 5);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_maintenance_start(server, 80));
+    shim_wifi.scan_ms = 300;
+
+    shim_httpd_exchange_t scan = { .authorization = AUTH_OK, .requested_with = FETCH };
+    TEST_ASSERT(httpd_task_request(server, "/scanap", &scan) == ESP_OK);
+    TEST_ASSERT(scan.async);
+
+    // Second scan and settings save while scan runs
+    const char *uris[] = { "/scanap", "/savewifi" };
+    for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++)
+    {
+        shim_httpd_exchange_t busy = { .authorization = AUTH_OK, .requested_with = FETCH,
+                                        .query = "ssid=HomeAP&password=password123" };
+        TEST_ASSERT(httpd_task_request(server, uris[i], &busy) == ESP_OK);
+        TEST_ASSERT(!busy.async);
+        TEST_ASSERT_EQUAL_STRING("503 Service Unavailable", busy.status);
+        shim_httpd_exchange_free(&busy);
+    }
+
+    TEST_ASSERT(shim_httpd_wait(&scan, 5000));
+    TEST_ASSERT_EQUAL_STRING("200 OK", scan.status);
+    TEST_ASSERT(strstr(scan.resp, "AccessPoint-00") != NULL);
+    shim_httpd_exchange_free(&scan);
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.scans);
+    TEST_ASSERT(shim_task_wait_idle("maintenance_req", 1000));
+
+    // Idle again, settings save runs off httpd task
+    shim_httpd_exchange_t save = { .authorization = AUTH_OK, .requested_with = FETCH,
+                                  .query = "ssid=HomeAP&password=password123" };
+    TEST_ASSERT(httpd_task_request(server, "/savewifi", &save) == ESP_OK);
+    TEST_ASSERT(save.async);
+    TEST_ASSERT(shim_httpd_wait(&save, 5000));
+    TEST_ASSERT_EQUAL_STRING("Wi-Fi settings saved.", save.resp);
+    shim_httpd_exchange_free(&save);
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.config_flash_writes);
+}
+
+// MARK: latency budget
+typedef struct {
+    httpd_handle_t server;
+    volatile bool *stop;
+    uint32_t       latency_us[APP_MAX_SAMPLES];
+    int            count;
+} app_client_t;
+
+static void *app_client(void *param)
+{
+    app_client_t *client = param;
+    while (!*client->stop && client->count < APP_MAX_SAMPLES)
+    {
+        shim_httpd_exchange_t ex = { 0 };
+        const uint64_t start = shim_time_us();
+        TEST_ASSERT(httpd_task_request(client->server, "/api/status", &ex) == ESP_OK);
+        client->latency_us[client->count++] = (uint32_t)(shim_time_us() - start);
+        TEST_ASSERT_EQUAL_STRING("200 OK", ex.status);
+        shim_httpd_exchange_free(&ex);
+        usleep(2000);
+    }
+    return NULL;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void test_app_latency_budget(void)
+{
+    httpd_handle_t server = app_server_setup(1 + 5);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_maintenance_start(server, 80));
+    shim_wifi.scan_ms = 400;        // Active scan of all channels
+    shim_wifi.flash_write_ms = 150; // NVS write of Wi-Fi config
+
+    volatile bool stop = false;
+    static app_client_t clients[APP_CLIENTS];
+    pthread_t threads[APP_CLIENTS];
+    for (int i = 0; i < APP_CLIENTS; i++)
+    {
+        clients[i] = (app_client_t){ .server = server, .stop = &stop };
+        TEST_ASSERT(pthread_create(&threads[i], NULL, app_client, &clients[i]) == 0);
+    }
+
+    // Portal user scans, saves new settings and reloads page while application serves its clients
+    int served = 0, busy = 0;
+    for (int round = 0; round < 3; round++)
+    {
+        char query[64];
+        snprintf(query, sizeof(query), "ssid=HomeAP&password=password%d", round);
+        const char *uris[] = { "/wifi", "/scanap", "/savewifi" };
+        for (int i = 0; i < sizeof(uris) / sizeof(uris[0]); i++)
+        {
+            shim_httpd_exchange_t ex = { .authorization = AUTH_OK, .requested_with = FETCH, .query = query };
+            TEST_ASSERT(httpd_task_request(server, uris[i], &ex) == ESP_OK);
+            TEST_ASSERT(shim_httpd_wait(&ex, 5000));
+            served += strcmp(ex.status, "200 OK") == 0;
+            busy += strcmp(ex.status, "503 Service Unavailable") == 0;
+            shim_httpd_exchange_free(&ex);
+            TEST_ASSERT(shim_task_wait_idle("maintenance_req", 1000));
+        }
+    }
+    stop = true;
+    for (int i = 0; i < APP_CLIENTS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    TEST_ASSERT_EQUAL_INT(9, served);
+    TEST_ASSERT_EQUAL_INT(0, busy);
+    TEST_ASSERT_EQUAL_INT(3, shim_wifi.scans);
+    TEST_ASSERT_EQUAL_INT(3, shim_wifi.config_flash_writes);
+
+    static uint32_t latency_us[APP_CLIENTS * APP_MAX_SAMPLES];
+    int count = 0;
+    for (int i = 0; i < APP_CLIENTS; i++)
+    {
+        memcpy(&latency_us[count], clients[i].latency_us, clients[i].count * sizeof(uint32_t));
+        count += clients[i].count;
+    }
+    TEST_ASSERT(count > 100);
+    qsort(latency_us, count, sizeof(uint32_t), compare_u32);
+    const uint32_t p50 = latency_us[count / 2], p99 = latency_us[count * 99 / 100], max = latency_us[count - 1];
+    printf("BENCH app /api/status under portal load  %d requests  p50 %u us  p99 %u us  max %u us\n", count, p50, p99, max);
+    TEST_ASSERT(max < APP_BUDGET_US); // Blocking scan or flash write on httpd task would take 150..400 ms
+}
+
+int main(void)
+{
+    RUN_TEST(test_register_error_returned);
+    RUN_TEST(test_authentication);
+    RUN_TEST(test_cross_site_request_refused);
+    RUN_TEST(test_single_request_in_flight);
+    RUN_TEST(test_app_latency_budget);
+    TEST_EXIT();
+}
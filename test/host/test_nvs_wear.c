@@ -0,0 +1,112 @@
+// Host tests of NVS flash wear: repeated settings writes with unchanged values must not reach flash,
+// settings reset erases only Wi-Fi and component settings. Counters from file backed NVS shim.
+#include "esp32-wifi-provision-care.c"
+#include "shim.h"
+#include "test_common.h"
+
+#define NVS_FILE "test_nvs_wear.nvs"
+
+static void savewifi(httpd_handle_t server, const char *query)
+{
+    shim_httpd_exchange_t ex = { .query = query };
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/savewifi", &ex) == ESP_OK);
+    TEST_ASSERT(shim_httpd_wait(&ex, 5000));
+    TEST_ASSERT_EQUAL_STRING("Wi-Fi settings saved.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+}
+
+static void test_savewifi_unchanged_no_writes(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    savewifi(server, "ssid=HomeAP&password=password123");
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.config_flash_writes);
+
+    const shim_nvs_wear_t before = shim_nvs_wear();
+    for (int i = 0; i < 20; i++)
+    {
+        savewifi(server, "ssid=HomeAP&password=password123");
+    }
+    const shim_nvs_wear_t after = shim_nvs_wear();
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.config_flash_writes);
+    TEST_ASSERT_EQUAL_INT(before.entry_writes, after.entry_writes);
+    TEST_ASSERT_EQUAL_INT(before.commits, after.commits);
+
+    savewifi(server, "ssid=HomeAP&password=newpassword");
+    TEST_ASSERT_EQUAL_INT(2, shim_wifi.config_flash_writes);
+    TEST_ASSERT(shim_nvs_wear().entry_writes > after.entry_writes);
+}
+
+static void test_ota_record_unchanged_no_writes(void)
+{
+    wpc_fresh_nvs(NVS_FILE);
+
+    ota_verify_record(WIFI_PROVISION_CARE_OTA_VALID, 1500);
+    shim_nvs_wear_t wear = shim_nvs_wear();
+    TEST_ASSERT_EQUAL_INT(1 + 2, wear.entry_writes); // Namespace and two keys
+    TEST_ASSERT_EQUAL_INT(1, wear.commits);
+
+    for (int i = 0; i < 20; i++) // Same result after every update
+    {
+        ota_verify_record(WIFI_PROVISION_CARE_OTA_VALID, 1500);
+    }
+    wear = shim_nvs_wear();
+    TEST_ASSERT_EQUAL_INT(1 + 2, wear.entry_writes);
+    TEST_ASSERT_EQUAL_INT(1, wear.commits);
+
+    ota_verify_record(WIFI_PROVISION_CARE_OTA_VALID, 1700); // Only changed key written
+    wear = shim_nvs_wear();
+    TEST_ASSERT_EQUAL_INT(1 + 2 + 1, wear.entry_writes);
+    TEST_ASSERT_EQUAL_INT(2, wear.commits);
+
+    // Persisted across reboot
+    TEST_ASSERT(nvs_flash_deinit() == ESP_OK);
+    TEST_ASSERT(nvs_flash_init() == ESP_OK);
+    nvs_handle_t nvs;
+    uint32_t verify_ms = 0;
+    TEST_ASSERT(nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK);
+    TEST_ASSERT(nvs_get_u32(nvs, "ota_verify_ms", &verify_ms) == ESP_OK);
+    nvs_close(nvs);
+    TEST_ASSERT_EQUAL_INT(1700, verify_ms);
+}
+
+static void test_nvserase_resets_settings(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    savewifi(server, "ssid=HomeAP&password=password123");
+    ota_verify_record(WIFI_PROVISION_CARE_OTA_VALID, 1500);
+    nvs_handle_t nvs;
+    TEST_ASSERT(nvs_open("other_app", NVS_READWRITE, &nvs) == ESP_OK);
+    TEST_ASSERT(nvs_set_u8(nvs, "boot_count", 7) == ESP_OK);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+    TEST_ASSERT(shim_restart_wait(1, 5000)); // Restart after savewifi
+
+    shim_httpd_exchange_t ex = { 0 };
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/nvserase", &ex) == ESP_OK);
+    TEST_ASSERT(shim_httpd_wait(&ex, 1000));
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT(shim_task_wait_idle("nvserase", 5000));
+
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.restores);
+    TEST_ASSERT_EQUAL_INT(0, shim_nvs_wear().partition_erases);
+    wifi_config_t wifi_cfg = { 0 };
+    esp_wifi_get_config(WIFI_IF_STA, &wifi_cfg);
+    TEST_ASSERT_EQUAL_STRING("", (char *)wifi_cfg.sta.ssid);
+    uint8_t value = 0;
+    TEST_ASSERT(nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK);
+    TEST_ASSERT(nvs_get_u8(nvs, "ota_result", &value) == ESP_ERR_NVS_NOT_FOUND);
+    nvs_close(nvs);
+    TEST_ASSERT(nvs_open("other_app", NVS_READONLY, &nvs) == ESP_OK); // Application settings kept
+    TEST_ASSERT(nvs_get_u8(nvs, "boot_count", &value) == ESP_OK);
+    nvs_close(nvs);
+    TEST_ASSERT_EQUAL_INT(7, value);
+    TEST_ASSERT(shim_restart_wait(2, 5000));
+}
+
+int main(void)
+{
+    RUN_TEST(test_savewifi_unchanged_no_writes);
+    RUN_TEST(test_ota_record_unchanged_no_writes);
+    RUN_TEST(test_nvserase_resets_settings);
+    TEST_EXIT();
+}
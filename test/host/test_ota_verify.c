@@ -0,0 +1,254 @@
+// Host tests of new firmware verification after update over the air: decision and finish steps against
+// simulated boot-state store, then whole flow against app_update and NVS shims.
+#define CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT 3 // Short deadline, flow tests wait it out
+#include "esp32-wifi-provision-care.c"
+#include "shim.h"
+#include "test_common.h"
+
+#define NVS_FILE "test_ota_verify.nvs"
+
+// MARK: simulated boot-state store
+static struct {
+    bool                             pending_verify;
+    bool                             rollback_possible;
+    bool                             rebooted;
+    int                              mark_valid_calls;
+    int                              mark_valid_failures; // Number of first mark valid calls to fail, e.g. flash error
+    int                              records;
+    wifi_provision_care_ota_result_t result_at_reboot;  // Record persisted when device rebooted
+    wifi_provision_care_ota_result_t result;
+    uint32_t                         verify_ms;
+} s_sim;
+
+static bool sim_pending_verify(void)
+{
+    return s_sim.pending_verify;
+}
+
+static esp_err_t sim_mark_valid(void)
+{
+    if (s_sim.mark_valid_calls++ < s_sim.mark_valid_failures)
+    {
+        return ESP_FAIL;
+    }
+    s_sim.pending_verify = false;
+    return ESP_OK;
+}
+
+static esp_err_t sim_mark_invalid_and_reboot(void)
+{
+    if (!s_sim.rollback_possible)
+    {
+        return ESP_ERR_OTA_ROLLBACK_FAILED;
+    }
+    s_sim.rebooted = true;
+    s_sim.result_at_reboot = s_sim.result;
+    return ESP_OK; // Real device never gets here
+}
+
+static void sim_record(wifi_provision_care_ota_result_t result, uint32_t verify_ms)
+{
+    s_sim.records++;
+    s_sim.result = result;
+    s_sim.verify_ms = verify_ms;
+}
+
+static const ota_boot_state_t s_sim_boot_state = {
+    .pending_verify = sim_pending_verify,
+    .mark_valid = sim_mark_valid,
+    .mark_invalid_and_reboot = sim_mark_invalid_and_reboot,
+    .record = sim_record,
+};
+
+static bool health_ok(void)
+{
+    return true;
+}
+
+static int s_health_calls = 0;
+static bool health_fail(void)
+{
+    s_health_calls++;
+    return false;
+}
+
+// Application backend reachable on third poll
+static bool health_ok_on_third_call(void)
+{
+    return ++s_health_calls >= 3;
+}
+
+static void test_decide(void)
+{
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, ota_verify_decide(true, NULL, 0));
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, ota_verify_decide(true, health_ok, 0));
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_CHECK_FAILED, ota_verify_decide(true, health_fail, 0));
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_NO_WIFI, ota_verify_decide(false, NULL, 10000));
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_NO_WIFI, ota_verify_decide(false, health_ok, 10000)); // Check not called
+}
+
+static void test_decide_polls_until_deadline(void)
+{
+    uint64_t start = shim_time_us();
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, ota_verify_decide(true, health_ok_on_third_call, 10000));
+    TEST_ASSERT_EQUAL_INT(3, s_health_calls);
+    TEST_ASSERT(shim_time_us() - start >= 2 * OTA_VERIFY_POLL_MS * 1000); // Passed after two poll periods
+
+    s_health_calls = 0;
+    start = shim_time_us();
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_CHECK_FAILED, ota_verify_decide(true, health_fail, 2500));
+    TEST_ASSERT_EQUAL_INT(3, s_health_calls); // At 0, 1000 and 2000 ms
+    TEST_ASSERT(shim_time_us() - start < 2500 * 1000);
+}
+
+static void test_finish_valid(void)
+{
+    s_sim.pending_verify = true;
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, ota_verify_finish(&s_sim_boot_state, WIFI_PROVISION_CARE_OTA_VALID, 1234));
+    TEST_ASSERT_EQUAL_INT(1, s_sim.mark_valid_calls);
+    TEST_ASSERT(!s_sim.pending_verify);
+    TEST_ASSERT(!s_sim.rebooted);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, s_sim.result);
+    TEST_ASSERT_EQUAL_INT(1234, s_sim.verify_ms);
+}
+
+static void test_finish_mark_valid_failed(void)
+{
+    s_sim.pending_verify = true;
+    s_sim.mark_valid_failures = OTA_MARK_VALID_RETRIES;
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_MARK_VALID_FAILED,
+                          ota_verify_finish(&s_sim_boot_state, WIFI_PROVISION_CARE_OTA_VALID, 1234));
+    TEST_ASSERT_EQUAL_INT(OTA_MARK_VALID_RETRIES, s_sim.mark_valid_calls);
+    TEST_ASSERT(s_sim.pending_verify); // Bootloader rolls back on next reset
+    TEST_ASSERT_EQUAL_INT(1, s_sim.records);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_MARK_VALID_FAILED, s_sim.result);
+}
+
+static void test_finish_mark_valid_retried(void)
+{
+    s_sim.pending_verify = true;
+    s_sim.mark_valid_failures = 1;
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, ota_verify_finish(&s_sim_boot_state, WIFI_PROVISION_CARE_OTA_VALID, 1234));
+    TEST_ASSERT_EQUAL_INT(2, s_sim.mark_valid_calls);
+    TEST_ASSERT(!s_sim.pending_verify);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, s_sim.result);
+}
+
+static void test_finish_rollback(void)
+{
+    s_sim.pending_verify = true;
+    s_sim.rollback_possible = true;
+    ota_verify_finish(&s_sim_boot_state, WIFI_PROVISION_CARE_OTA_NO_WIFI, 120000);
+    TEST_ASSERT(s_sim.rebooted);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_NO_WIFI, s_sim.result_at_reboot); // Recorded before reboot
+    TEST_ASSERT_EQUAL_INT(0, s_sim.mark_valid_calls);
+}
+
+static void test_finish_rollback_failed(void)
+{
+    s_sim.pending_verify = true;
+    s_sim.rollback_possible = false; // No valid previous firmware
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED,
+                          ota_verify_finish(&s_sim_boot_state, WIFI_PROVISION_CARE_OTA_CHECK_FAILED, 50));
+    TEST_ASSERT(!s_sim.rebooted);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED, s_sim.result);
+    TEST_ASSERT_EQUAL_INT(0, s_sim.mark_valid_calls);
+}
+
+static void test_not_pending_verify(void)
+{
+    s_ota_boot_state = &s_sim_boot_state;
+    s_sim.pending_verify = false;
+    ota_verify_start();
+    TEST_ASSERT(s_semph_ota_verify == NULL);
+    TEST_ASSERT_EQUAL_INT(0, shim_task_created("ota_verify"));
+}
+
+// MARK: whole flow on shims
+static uint8_t nvs_ota_result(void)
+{
+    nvs_handle_t nvs;
+    uint8_t result = 0;
+    TEST_ASSERT(nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK);
+    TEST_ASSERT(nvs_get_u8(nvs, "ota_result", &result) == ESP_OK);
+    nvs_close(nvs);
+    return result;
+}
+
+// Running firmware just updated and pending verify
+static void boot_after_update(wifi_provision_care_health_check_t health_check, esp_ota_img_states_t previous_state)
+{
+    wpc_fresh_wifi(NVS_FILE);
+    wifi_config_t wifi_cfg = { .sta = { .ssid = "HomeAP", .password = "password123" } };
+    TEST_ASSERT(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg) == ESP_OK);
+    shim_ota_set_state(esp_ota_get_running_partition(), ESP_OTA_IMG_PENDING_VERIFY);
+    shim_ota_set_state(esp_ota_get_next_update_partition(NULL), previous_state);
+
+    wifi_provision_care_set_health_check(health_check);
+    wifi_provision_care("");
+    TEST_ASSERT(shim_task_wait_idle("ota_verify", 5000));
+}
+
+static void test_flow_valid(void)
+{
+    boot_after_update(health_ok, ESP_OTA_IMG_VALID);
+    esp_ota_img_states_t state;
+    esp_ota_get_state_partition(esp_ota_get_running_partition(), &state);
+    TEST_ASSERT_EQUAL_INT(ESP_OTA_IMG_VALID, state);
+    TEST_ASSERT_EQUAL_INT(1, shim_ota.mark_valid_calls);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, nvs_ota_result());
+
+    // Semaphore outlives verification task, IP events after reconnect still give it
+    ip_event_got_ip_t got_ip = { .esp_netif = s_wifi_sta_netif };
+    for (int i = 0; i < 3; i++)
+    {
+        esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), portMAX_DELAY);
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+}
+
+// Health check passes once application connected to its backend, some seconds after Wi-Fi
+static void test_flow_check_passes_late(void)
+{
+    boot_after_update(health_ok_on_third_call, ESP_OTA_IMG_VALID);
+    TEST_ASSERT_EQUAL_INT(3, s_health_calls);
+    TEST_ASSERT_EQUAL_INT(1, shim_ota.mark_valid_calls);
+    TEST_ASSERT_EQUAL_INT(0, shim_ota.rollback_calls);
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_VALID, nvs_ota_result());
+}
+
+static void test_flow_check_failed(void)
+{
+    boot_after_update(health_fail, ESP_OTA_IMG_VALID);
+    TEST_ASSERT(s_health_calls >= CONFIG_WIFI_PROVISION_CARE_OTA_VERIFY_TIMEOUT - 1); // Polled until deadline
+    TEST_ASSERT_EQUAL_INT(1, shim_ota.rollback_calls);
+    TEST_ASSERT_EQUAL_INT(1, shim_restart_count());
+    TEST_ASSERT(esp_ota_get_boot_partition() != esp_ota_get_running_partition());
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_CHECK_FAILED, nvs_ota_result());
+}
+
+static void test_flow_rollback_failed(void)
+{
+    boot_after_update(health_fail, ESP_OTA_IMG_INVALID); // Previous firmware unusable
+    TEST_ASSERT_EQUAL_INT(1, shim_ota.rollback_calls);
+    TEST_ASSERT_EQUAL_INT(0, shim_restart_count());
+    TEST_ASSERT(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+    TEST_ASSERT_EQUAL_INT(WIFI_PROVISION_CARE_OTA_ROLLBACK_FAILED, nvs_ota_result());
+}
+
+int main(void)
+{
+    RUN_TEST(test_decide);
+    RUN_TEST(test_decide_polls_until_deadline);
+    RUN_TEST(test_finish_valid);
+    RUN_TEST(test_finish_mark_valid_failed);
+    RUN_TEST(test_finish_mark_valid_retried);
+    RUN_TEST(test_finish_rollback);
+    RUN_TEST(test_finish_rollback_failed);
+    RUN_TEST(test_not_pending_verify);
+    RUN_TEST(test_flow_valid);
+    RUN_TEST(test_flow_check_passes_late);
+    RUN_TEST(test_flow_check_failed);
+    RUN_TEST(test_flow_rollback_failed);
+    TEST_EXIT();
+}
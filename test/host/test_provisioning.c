@@ -0,0 +1,232 @@
+// Host tests of connect state machine, provisioning handlers and push OTA, with handler micro-benchmarks.
+#include "esp32-wifi-provision-care.c"
+#include "shim.h"
+#include "test_common.h"
+
+#define NVS_FILE "test_provisioning.nvs"
+
+static void store_credentials(const char *ssid, const char *password)
+{
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    TEST_ASSERT(esp_wifi_init(&cfg) == ESP_OK);
+    wifi_config_t wifi_cfg = { 0 };
+    strcpy((char *)wifi_cfg.sta.ssid, ssid);
+    strcpy((char *)wifi_cfg.sta.password, password);
+    TEST_ASSERT(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg) == ESP_OK);
+}
+
+// MARK: connect state machine
+static void test_connect_with_stored_credentials(void)
+{
+    wpc_fresh_nvs(NVS_FILE);
+    store_credentials("HomeAP", "password123");
+    shim_wifi.connect_fail_count = 2; // Two retries before AP answers
+
+    wifi_provision_care("MyAP"); // Returns when IP address acquired
+
+    TEST_ASSERT_EQUAL_INT(3, shim_wifi.connect_calls);
+    wifi_mode_t mode;
+    esp_wifi_get_mode(&mode);
+    TEST_ASSERT_EQUAL_INT(WIFI_MODE_STA, mode);
+    TEST_ASSERT_EQUAL_INT(0, shim_task_created("start_softap"));
+}
+
+static void softap_task(void *param)
+{
+    wifi_provision_care((char *)param); // Never returns in SoftAP mode
+}
+
+static void test_softap_without_credentials(void)
+{
+    wpc_fresh_nvs(NVS_FILE);
+    xTaskCreate(softap_task, "app_main", 4096, "MyAP", 1, NULL);
+
+    wifi_mode_t mode = WIFI_MODE_NULL;
+    for (int i = 0; i < 100 && mode != WIFI_MODE_APSTA; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        esp_wifi_get_mode(&mode);
+    }
+    TEST_ASSERT_EQUAL_INT(WIFI_MODE_APSTA, mode);
+    wifi_config_t ap_cfg;
+    esp_wifi_get_config(WIFI_IF_AP, &ap_cfg);
+    TEST_ASSERT_EQUAL_STRING("MyAP", (char *)ap_cfg.ap.ssid);
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.connect_calls);
+    TEST_ASSERT_EQUAL_INT(1, shim_task_created("delayed_restart_10m"));
+}
+
+// MARK: handlers
+static void test_static_pages(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    shim_httpd_exchange_t ex = { 0 };
+
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/favicon.ico", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("image/x-icon", ex.content_type);
+    FILE *f = fopen("embed/esp32-wifi-provision-care-favicon.ico", "rb");
+    TEST_ASSERT(f != NULL);
+    fseek(f, 0, SEEK_END);
+    TEST_ASSERT_EQUAL_INT(ftell(f), ex.resp_len);
+    fclose(f);
+    shim_httpd_exchange_free(&ex);
+
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/wifi", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("text/html", ex.content_type);
+    TEST_ASSERT(ex.resp_len > 2 && (uint8_t)ex.resp[0] == 0x1f && (uint8_t)ex.resp[1] == 0x8b); // gzip
+    shim_httpd_exchange_free(&ex);
+
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/generate_204", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("302 Temporary Redirect", ex.status);
+    TEST_ASSERT_EQUAL_STRING("http://200.200.200.2/wifi", ex.location);
+    shim_httpd_exchange_free(&ex);
+}
+
+static void test_scanap(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    const char *ssids[] = { "Alpha", "Beta \"quoted\"", "Gamma" };
+    for (int i = 0; i < 3; i++)
+    {
+        strcpy((char *)shim_wifi.scan_records[i].ssid, ssids[i]);
+        shim_wifi.scan_records[i].rssi = -40 - i * 10;
+        shim_wifi.scan_records[i].authmode = WIFI_AUTH_WPA2_PSK;
+    }
+    shim_wifi.scan_record_count = 3;
+
+    shim_httpd_exchange_t ex = { 0 };
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/scanap", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("application/json", ex.content_type);
+    TEST_ASSERT(strstr(ex.resp, "\"ssid\":\t\"Alpha\"") != NULL);
+    TEST_ASSERT(strstr(ex.resp, "\"ssid\":\t\"Beta \\\"quoted\\\"\"") != NULL);
+    TEST_ASSERT(strstr(ex.resp, "\"rssi\":\t-60") != NULL);
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.scans);
+}
+
+static void test_savewifi(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    shim_httpd_exchange_t ex = { 0 };
+
+    ex.query = "ssid=HomeAP";
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/savewifi", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("Error. Wi-Fi settings incorrect.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT_EQUAL_INT(0, shim_wifi.config_flash_writes);
+
+    ex.query = "ssid=HomeAP&password=password123";
+    TEST_ASSERT(shim_httpd_request(server, HTTP_GET, "/savewifi", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("Wi-Fi settings saved.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT_EQUAL_INT(1, shim_wifi.config_flash_writes);
+    TEST_ASSERT(shim_restart_wait(1, 5000));
+
+    // Credentials survive reboot
+    TEST_ASSERT(nvs_flash_deinit() == ESP_OK);
+    TEST_ASSERT(nvs_flash_init() == ESP_OK);
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    TEST_ASSERT(esp_wifi_init(&cfg) == ESP_OK);
+    wifi_config_t stored;
+    TEST_ASSERT(esp_wifi_get_config(WIFI_IF_STA, &stored) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("HomeAP", (char *)stored.sta.ssid);
+    TEST_ASSERT_EQUAL_STRING("password123", (char *)stored.sta.password);
+}
+
+// MARK: push ota
+static void test_updateota(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    const size_t image_size = 300 * 1024;
+    uint8_t *image = make_image(image_size);
+    shim_httpd_exchange_t ex = { 0 };
+
+    ex.body = (const char *)image;
+    ex.body_len = 0;
+    TEST_ASSERT(shim_httpd_request(server, HTTP_POST, "/updateota", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("500 Internal Server Error", ex.status);
+    TEST_ASSERT_EQUAL_STRING("Firmware too short.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+
+    ex.body_len = update_partition->size + 1;
+    TEST_ASSERT(shim_httpd_request(server, HTTP_POST, "/updateota", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("Firmware too big.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+
+    image[0] = 0x00; // Corrupted header
+    ex.body_len = image_size;
+    ex.recv_chunk = 5760;
+    TEST_ASSERT(shim_httpd_request(server, HTTP_POST, "/updateota", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("500 Internal Server Error", ex.status);
+    shim_httpd_exchange_free(&ex);
+    TEST_ASSERT(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+
+    image[0] = 0xE9;
+    TEST_ASSERT(shim_httpd_request(server, HTTP_POST, "/updateota", &ex) == ESP_OK);
+    TEST_ASSERT_EQUAL_STRING("200 OK", ex.status);
+    TEST_ASSERT_EQUAL_STRING("Update firmware over the air finished sucessfully.", ex.resp);
+    shim_httpd_exchange_free(&ex);
+    size_t written_size = 0;
+    const uint8_t *written = shim_ota_image(update_partition, &written_size);
+    TEST_ASSERT_EQUAL_INT(image_size, written_size);
+    TEST_ASSERT(memcmp(written, image, image_size) == 0);
+    TEST_ASSERT(esp_ota_get_boot_partition() == update_partition);
+    TEST_ASSERT(shim_restart_wait(1, 5000));
+    free(image);
+}
+
+// MARK: benchmarks
+static double bench_request(httpd_handle_t server, httpd_method_t method, const char *uri, shim_httpd_exchange_t *ex,
+                            int iterations)
+{
+    const uint64_t start = shim_time_us();
+    for (int i = 0; i < iterations; i++)
+    {
+        shim_httpd_request(server, method, uri, ex);
+        shim_httpd_exchange_free(ex);
+    }
+    return (double)(shim_time_us() - start) / iterations;
+}
+
+static void bench_handlers(void)
+{
+    httpd_handle_t server = wpc_handlers_setup(NVS_FILE);
+    for (int i = 0; i < 15; i++)
+    {
+        snprintf((char *)shim_wifi.scan_records[i].ssid, sizeof(shim_wifi.scan_records[i].ssid), "AccessPoint-%02d", i);
+        shim_wifi.scan_records[i].rssi = -30 - i;
+    }
+    shim_wifi.scan_record_count = 15;
+    store_credentials("HomeAP", "password123");
+
+    shim_httpd_exchange_t ex = { 0 };
+    printf("BENCH /wifi                 %8.2f us/op\n", bench_request(server, HTTP_GET, "/wifi", &ex, 2000));
+    printf("BENCH /favicon.ico          %8.2f us/op\n", bench_request(server, HTTP_GET, "/favicon.ico", &ex, 2000));
+    printf("BENCH 404 redirect          %8.2f us/op\n", bench_request(server, HTTP_GET, "/hotspot-detect.html", &ex, 2000));
+    printf("BENCH /scanap 15 APs        %8.2f us/op\n", bench_request(server, HTTP_GET, "/scanap", &ex, 2000));
+    ex.query = "ssid=HomeAP&password=password123";
+    printf("BENCH /savewifi unchanged   %8.2f us/op\n", bench_request(server, HTTP_GET, "/savewifi", &ex, 100));
+
+    const size_t image_size = 1000 * 1024;
+    uint8_t *image = make_image(image_size);
+    ex = (shim_httpd_exchange_t){ .body = (const char *)image, .body_len = image_size, .recv_chunk = 5760 };
+    const uint64_t start = shim_time_us();
+    shim_httpd_request(server, HTTP_POST, "/updateota", &ex);
+    const uint64_t elapsed_us = shim_time_us() - start;
+    TEST_ASSERT_EQUAL_STRING("200 OK", ex.status);
+    shim_httpd_exchange_free(&ex);
+    printf("BENCH /updateota 1000 KiB   %8.2f MiB/s\n", (double)image_size / (1024 * 1024) / (elapsed_us / 1e6));
+    free(image);
+}
+
+int main(void)
+{
+    RUN_TEST(test_connect_with_stored_credentials);
+    RUN_TEST(test_softap_without_credentials);
+    RUN_TEST(test_static_pages);
+    RUN_TEST(test_scanap);
+    RUN_TEST(test_savewifi);
+    RUN_TEST(test_updateota);
+    RUN_TEST(bench_handlers);
+    TEST_EXIT();
+}
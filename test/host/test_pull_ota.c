@@ -0,0 +1,319 @@
+// Host tests of pull update over the air against local stand-in HTTP server with range requests,
+// keep-alive, per request latency and injected faults.
+#define _GNU_SOURCE
+#include "esp32-wifi-provision-care.c"
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "shim.h"
+#include "test_common.h"
+
+// MARK: stand-in HTTP server
+static struct {
+    pthread_mutex_t mutex;
+    const uint8_t  *image;
+    size_t          size;
+    uint32_t        latency_ms;  // Delay before each response, models network round trip
+    int             fail_503;    // Number of range requests to answer "503 Service Unavailable"
+    int             drop;        // Number of range responses to cut after half of body
+    int             overlong;    // Number of range responses to extend to end of image, as misbehaving proxy
+    bool            no_range;    // Ignore Range header, answer "200 OK" with whole image
+    int             connections;
+    int             requests;
+    uint16_t        port;
+} s_srv = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static bool srv_take(int *counter)
+{
+    pthread_mutex_lock(&s_srv.mutex);
+    const bool take = *counter > 0;
+    *counter -= take;
+    pthread_mutex_unlock(&s_srv.mutex);
+    return take;
+}
+
+static bool srv_send(int fd, const void *buf, size_t len)
+{
+    return send(fd, buf, len, MSG_NOSIGNAL) == (ssize_t)len;
+}
+
+static void *srv_connection(void *param)
+{
+    const int fd = (int)(intptr_t)param;
+    char req[2048];
+    size_t len = 0;
+    for (;;)
+    {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        len += n;
+        req[len] = '\0';
+        char *end = strstr(req, "\r\n\r\n");
+        if (end == NULL)
+        {
+            continue;
+        }
+        pthread_mutex_lock(&s_srv.mutex);
+        s_srv.requests++;
+        pthread_mutex_unlock(&s_srv.mutex);
+        usleep(s_srv.latency_ms * 1000);
+
+        char head[256];
+        long first = 0, last = (long)s_srv.size - 1;
+        const char *range = strcasestr(req, "\r\nRange: bytes=");
+        const bool ranged = range != NULL && range < end && !s_srv.no_range &&
+                            sscanf(range + 15, "%ld-%ld", &first, &last) == 2;
+        bool ok = true;
+        if (strncmp(req, "HEAD ", 5) == 0)
+        {
+            snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", s_srv.size);
+            ok = srv_send(fd, head, strlen(head));
+        } else if (ranged && srv_take(&s_srv.fail_503)) {
+            snprintf(head, sizeof(head), "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4\r\n\r\nbusy");
+            ok = srv_send(fd, head, strlen(head));
+        } else if (ranged) {
+            if (srv_take(&s_srv.overlong))
+            {
+                last = (long)s_srv.size - 1;
+            }
+            const size_t body = last - first + 1;
+            snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes %ld-%ld/%zu\r\n"
+                     "Content-Length: %zu\r\n\r\n", first, last, s_srv.size, body);
+            if (srv_take(&s_srv.drop))
+            {
+                srv_send(fd, head, strlen(head));
+                srv_send(fd, s_srv.image + first, body / 2);
+                break;
+            }
+            ok = srv_send(fd, head, strlen(head)) && srv_send(fd, s_srv.image + first, body);
+        } else {
+            snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", s_srv.size);
+            ok = srv_send(fd, head, strlen(head)) && srv_send(fd, s_srv.image, s_srv.size);
+        }
+        if (!ok)
+        {
+            break;
+        }
+        len -= (end + 4 - req);
+        memmove(req, end + 4, len);
+    }
+    close(fd);
+    return NULL;
+}
+
+static void *srv_accept(void *param)
+{
+    const int listen_fd = (int)(intptr_t)param;
+    for (;;)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        pthread_mutex_lock(&s_srv.mutex);
+        s_srv.connections++;
+        pthread_mutex_unlock(&s_srv.mutex);
+        pthread_t thread;
+        pthread_create(&thread, NULL, srv_connection, (void *)(intptr_t)fd);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static void srv_start(const uint8_t *image, size_t size)
+{
+    s_srv.image = image;
+    s_srv.size = size;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(fd >= 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t addr_len = sizeof(addr);
+    TEST_ASSERT(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    TEST_ASSERT(listen(fd, 8) == 0);
+    TEST_ASSERT(getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0);
+    s_srv.port = ntohs(addr.sin_port);
+    pthread_t thread;
+    TEST_ASSERT(pthread_create(&thread, NULL, srv_accept, (void *)(intptr_t)fd) == 0);
+    pthread_detach(thread);
+}
+
+// MARK: helpers
+static char s_url[64];
+static char s_sha256_hex[65];
+
+// Serve image from stand-in server, fill s_url and s_sha256_hex
+static uint8_t *serve_image(size_t size)
+{
+    uint8_t *image = make_image(size);
+    srv_start(image, size);
+    snprintf(s_url, sizeof(s_url), "http://127.0.0.1:%u/firmware.bin", s_srv.port);
+    unsigned char digest[32];
+    mbedtls_sha256(image, size, digest, 0);
+    for (int i = 0; i < sizeof(digest); i++)
+    {
+        sprintf(&s_sha256_hex[i * 2], "%02x", digest[i]);
+    }
+    return image;
+}
+
+static bool image_written(const uint8_t *image, size_t size)
+{
+    size_t written_size = 0;
+    const uint8_t *written = shim_ota_image(esp_ota_get_next_update_partition(NULL), &written_size);
+    return written != NULL && written_size == size && memcmp(written, image, size) == 0;
+}
+
+// MARK: tests
+static void test_pull_ok(void)
+{
+    const size_t size = 200 * 1024 + 123; // Last range partial
+    uint8_t *image = serve_image(size);
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(image_written(image, size));
+    TEST_ASSERT(esp_ota_get_boot_partition() == update_partition);
+    // HEAD request, then each fetcher reuses one keep-alive connection for all its ranges
+    TEST_ASSERT_EQUAL_INT(1 + PULLOTA_FETCHERS, shim_http_client_connects());
+    TEST_ASSERT_EQUAL_INT(1 + PULLOTA_FETCHERS, s_srv.connections);
+    TEST_ASSERT_EQUAL_INT(1 + (size + PULLOTA_RANGE_SIZE - 1) / PULLOTA_RANGE_SIZE, s_srv.requests);
+    TEST_ASSERT(shim_restart_wait(1, 5000));
+    free(image);
+}
+
+static void test_pull_retry_503(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    s_srv.fail_503 = 2;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(image_written(image, size));
+    free(image);
+}
+
+static void test_pull_resume_dropped(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    s_srv.drop = 1;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(image_written(image, size));
+    TEST_ASSERT_EQUAL_INT(1 + PULLOTA_FETCHERS + 1, shim_http_client_connects()); // One reconnect to resume
+    free(image);
+}
+
+static void test_pull_wrong_range_retried(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    s_srv.overlong = 1;
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(image_written(image, size));
+    TEST_ASSERT_EQUAL_INT(1 + PULLOTA_FETCHERS + 1, shim_http_client_connects()); // Poisoned connection closed
+    free(image);
+}
+
+static void test_pull_no_range_support(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    s_srv.no_range = true;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_SUPPORTED, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+    free(image);
+}
+
+static void test_pull_sha256_mismatch(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    s_sha256_hex[10] = (s_sha256_hex[10] == '0') ? '1' : '0';
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_CRC, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+    free(image);
+}
+
+static void test_pull_too_big(void)
+{
+    const size_t size = 1024 * 1024 + 1;
+    uint8_t *image = serve_image(size);
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_INVALID_SIZE, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    TEST_ASSERT_EQUAL_INT(1, s_srv.requests); // HEAD only
+    free(image);
+}
+
+static void test_pull_no_update_partition(void)
+{
+    const size_t size = 64 * 1024;
+    uint8_t *image = serve_image(size);
+    shim_ota.no_update_partition = true;
+    TEST_ASSERT_EQUAL_INT(ESP_ERR_NOT_FOUND, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    free(image);
+}
+
+// Same ranges over one keep-alive connection, each range written to flash before next is requested
+static uint64_t single_stream_us(size_t size)
+{
+    const esp_partition_t *partition = NULL;
+    esp_ota_handle_t handle = 0;
+    char *buf = malloc(PULLOTA_RANGE_SIZE);
+    TEST_ASSERT(buf != NULL);
+    esp_http_client_config_t config = { .url = s_url, .timeout_ms = 10000, .keep_alive_enable = true };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    TEST_ASSERT(client != NULL);
+
+    const uint64_t start = shim_time_us();
+    TEST_ASSERT(ota_begin(size, &partition, &handle) == ESP_OK);
+    for (size_t offset = 0; offset < size; offset += PULLOTA_RANGE_SIZE)
+    {
+        const int len = (size - offset > PULLOTA_RANGE_SIZE) ? PULLOTA_RANGE_SIZE : size - offset;
+        TEST_ASSERT(pullota_fetch_range(client, offset, len, buf) == ESP_OK);
+        TEST_ASSERT(esp_ota_write(handle, buf, len) == ESP_OK);
+    }
+    TEST_ASSERT(ota_finish(handle, partition) == ESP_OK);
+    const uint64_t elapsed_us = shim_time_us() - start;
+
+    esp_http_client_cleanup(client);
+    free(buf);
+    return elapsed_us;
+}
+
+static void bench_pull_throughput(void)
+{
+    const size_t size = 512 * 1024;
+    uint8_t *image = serve_image(size);
+    s_srv.latency_ms = 10;          // LAN round trip and server response time
+    shim_ota.write_us_per_kib = 400; // ESP32 flash erase and write
+
+    const uint64_t single_us = single_stream_us(size);
+    uint64_t start = shim_time_us();
+    TEST_ASSERT_EQUAL_INT(ESP_OK, wifi_provision_care_pull_ota(s_url, s_sha256_hex));
+    const uint64_t parallel_us = shim_time_us() - start;
+    TEST_ASSERT(image_written(image, size));
+
+    printf("BENCH pull single stream    %8.2f KiB/s\n", (double)size / 1024 / (single_us / 1e6));
+    printf("BENCH pull %d fetchers       %8.2f KiB/s\n", PULLOTA_FETCHERS, (double)size / 1024 / (parallel_us / 1e6));
+    TEST_ASSERT(parallel_us * 4 < single_us * 3); // At least 1.33x single stream
+    free(image);
+}
+
+int main(void)
+{
+    RUN_TEST(test_pull_ok);
+    RUN_TEST(test_pull_retry_503);
+    RUN_TEST(test_pull_resume_dropped);
+    RUN_TEST(test_pull_wrong_range_retried);
+    RUN_TEST(test_pull_no_range_support);
+    RUN_TEST(test_pull_sha256_mismatch);
+    RUN_TEST(test_pull_too_big);
+    RUN_TEST(test_pull_no_update_partition);
+    RUN_TEST(bench_pull_throughput);
+    TEST_EXIT();
+}